@@ -4,9 +4,9 @@
  ******************************************************************************/
 #include <thread>               // std::this_thread
 #include <string>
+#include <cstring>              // std::memset
 #include <iostream>
 #include <algorithm>            // std::min
-#include <sstream>              // std::stringstream
 #include <ctime>                // time_t, strftime
 #include <syslog.h>             // syslog()
 #include <linux/dvb/frontend.h> // fe_status_t, dvb_frontend_info
@@ -18,6 +18,8 @@
 #include "menusetup.h"          // MenuScanning
 #include "satellites.h"         // txt_to_satellite()
 #include "countries.h"          // txt_to_country()
+#include "lockprofiles.h"       // LockProfiles
+#include "format.h"             // AppendInt(), AppendHex(), AppendParam(), AppendFloat()
 
 /*******************************************************************************
  *  Generic functions which will be used in the whole plugin.
@@ -49,6 +51,9 @@ cMySetup::cMySetup(void) {
   ParseLCN             = false;
   SignalWaitTime       = 1;
   LockTimeout          = 3;
+  ParallelScan         = false;          /* one device only               */
+  SdtOther             = false;          /* SDT actual only               */
+  PreSweep             = true;           /* check for carrier first       */
 }
 
 void cMySetup::InitSystems(void) {
@@ -399,159 +404,179 @@ void TChannel::CopyTransponderData(const TChannel* Channel) {
      }
 }
 
-void TChannel::Params(std::string& s) {
-  s.clear();
-  s.reserve(18 * 4);
+int FormatFreq(int f);
+
+TTransponderKey TChannel::Key(void) const {
+  TTransponderKey k;
+  std::memset(&k, 0, sizeof(k));
+  Source.copy(k.Source, sizeof(k.Source) - 1);
+  k.Frequency    = FormatFreq(Frequency);
+  k.Symbolrate   = Symbolrate;
+  k.Bandwidth    = Bandwidth;
+  k.FEC          = FEC;
+  k.FEC_low      = FEC_low;
+  k.Guard        = Guard;
+  k.Modulation   = Modulation;
+  k.Hierarchy    = Hierarchy;
+  k.Transmission = Transmission;
+  k.StreamId     = StreamId;
+  k.DelSys       = DelSys;
+  k.Polarization = Polarization;
+  return k;
+}
 
-  if (Source.size() == 0)
+/* the channel line formatters append to the caller's string, without
+ * stringstreams and temporary strings, see format.h.
+ */
+static void AppendPids(std::string& dest, TList<TPid>& Pids, char First) {
+  auto pids = Pids.Lock();
+  for(int i=0; i<pids.Count(); ++i) {
+     dest += (i == 0) ? First : ',';
+     AppendInt(dest, pids[i].PID);
+     if (not pids[i].Lang.empty()) {
+        dest += '=';
+        dest += pids[i].Lang;
+        }
+     if (pids[i].Type)
+        AppendParam(dest, '@', pids[i].Type);
+     }
+}
+
+static void AppendParams(std::string& s, const TChannel& c) {
+  if (c.Source.size() == 0)
      return;
 
-  switch(Source[0]) {
+  switch(c.Source[0]) {
      case 'A':
-        if (Inversion != 999)       s += "I" + IntToStr(Inversion);
-        if (Modulation != 999)      s += "M" + IntToStr(Modulation);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
         break;
      case 'C':
-        if (FEC != 999)             s += "C" + IntToStr(FEC);
-        if (Inversion != 999)       s += "I" + IntToStr(Inversion);
-        if (Modulation != 999)      s += "M" + IntToStr(Modulation);
+        if (c.FEC != 999)               AppendParam(s, 'C', c.FEC);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
         break;
      case 'S':
-        if (Polarization)           s += Polarization;
-        if (FEC != 999)             s += "C" + IntToStr(FEC);
-        if (Inversion != 999)       s += "I" + IntToStr(Inversion);
-        if (Modulation != 999)      s += "M" + IntToStr(Modulation);
-        if (DelSys) {
-           if (Pilot != 999)        s += "N" + IntToStr(Pilot);
-           if (Rolloff != 999)      s += "O" + IntToStr(Rolloff);
-           if (StreamId != 999)     s += "P" + IntToStr(StreamId);
+        if (c.Polarization)             s += c.Polarization;
+        if (c.FEC != 999)               AppendParam(s, 'C', c.FEC);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
+        if (c.DelSys) {
+           if (c.Pilot != 999)          AppendParam(s, 'N', c.Pilot);
+           if (c.Rolloff != 999)        AppendParam(s, 'O', c.Rolloff);
+           if (c.StreamId != 999)       AppendParam(s, 'P', c.StreamId);
            }
-        if (DelSys != 999)          s += "S" + IntToStr(DelSys);
+        if (c.DelSys != 999)            AppendParam(s, 'S', c.DelSys);
         break;
      case 'T':
-        if (Bandwidth != 999)       s += "B" + IntToStr(Bandwidth);
-        if (FEC != 999)             s += "C" + IntToStr(FEC);
-        if (FEC_low != 999)         s += "D" + IntToStr(FEC_low);
-        if (Guard != 999)           s += "G" + IntToStr(Guard);
-        if (Inversion != 999)       s += "I" + IntToStr(Inversion);
-        if (Modulation != 999)      s += "M" + IntToStr(Modulation);
-        if (DelSys) {
-           if (StreamId != 999)     s += "P" + IntToStr(StreamId);
-           if (SystemId != 999)     s += "Q" + IntToStr(SystemId);
+        if (c.Bandwidth != 999)         AppendParam(s, 'B', c.Bandwidth);
+        if (c.FEC != 999)               AppendParam(s, 'C', c.FEC);
+        if (c.FEC_low != 999)           AppendParam(s, 'D', c.FEC_low);
+        if (c.Guard != 999)             AppendParam(s, 'G', c.Guard);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
+        if (c.DelSys) {
+           if (c.StreamId != 999)       AppendParam(s, 'P', c.StreamId);
+           if (c.SystemId != 999)       AppendParam(s, 'Q', c.SystemId);
            }
-        if (DelSys != 999)          s += "S" + IntToStr(DelSys);
-        if (Transmission != 999)    s += "T" + IntToStr(Transmission);
-        if (DelSys and MISO != 999) s += "X" + IntToStr(MISO);
-        if (Hierarchy != 999)       s += "Y" + IntToStr(Hierarchy);
+        if (c.DelSys != 999)            AppendParam(s, 'S', c.DelSys);
+        if (c.Transmission != 999)      AppendParam(s, 'T', c.Transmission);
+        if (c.DelSys and c.MISO != 999) AppendParam(s, 'X', c.MISO);
+        if (c.Hierarchy != 999)         AppendParam(s, 'Y', c.Hierarchy);
         break;
-     default: dlog(0, ": unknown Source " + Source);
+     default: dlog(0, ": unknown Source " + c.Source);
      }
 }
 
+void TChannel::Params(std::string& s) {
+  s.clear();
+  s.reserve(18 * 4);
+  AppendParams(s, *this);
+}
+
 void TChannel::PrintTransponder(std::string& dest) {
-  std::stringstream ss;
-  std::string params;
-  Params(params);
   int i = Frequency;
   char source = Source[0];
 
   if (i < 1000)    i *= 1000;
   if (i > 999999)  i /= 1000;
 
-  ss << source;
+  dest.clear();
+  dest += source;
 
   if (DelSys == 1)
-     ss << "2 ";
+     dest += "2 ";
   else
-     ss << "  ";
+     dest += "  ";
 
-  ss << FloatToStr((source == 'S')?i:i/1000.0, 8, 2, false) << " MHz";
+  AppendFloat(dest, (source == 'S')?i:i/1000.0, 8, 2);
+  dest += " MHz";
 
   if ((source == 'C') or (source == 'S')) {
      i = Symbolrate;
      if (i < 1000)    i *= 1000;
      if (i > 999999)  i /= 1000;
-     ss << " SR " << IntToStr(i) << ' ' << params;
+     dest += " SR ";
+     AppendInt(dest, i);
+     dest += ' ';
+     AppendParams(dest, *this);
      }
-
-  dest = std::move(ss.str());
 }
 
 void TChannel::Print(std::string& dest) {
-  std::stringstream ss;
-  std::string params;
-  Params(params);
+  dest.clear();
 
   if (Name.empty())
-     ss << "NULL";
+     dest += "NULL";
   else
-     ss << Name;
+     dest += Name;
 
-  if (not Shortname.empty())
-     ss <<  ',' << Shortname;
+  if (not Shortname.empty()) {
+     dest += ',';
+     dest += Shortname;
+     }
 
-  if (not Provider.empty())
-     ss <<  ';' << Provider;
+  if (not Provider.empty()) {
+     dest += ';';
+     dest += Provider;
+     }
 
-  ss << ':' << IntToStr(Frequency)
-     << ':' << params
-     << ':' << Source 
-     << ':' << IntToStr(Symbolrate)
-     << ':' << IntToStr(VPID.PID);
+  AppendParam(dest, ':', Frequency);
+  dest += ':';
+  AppendParams(dest, *this);
+  dest += ':';
+  dest += Source;
+  AppendParam(dest, ':', Symbolrate);
+  AppendParam(dest, ':', VPID.PID);
 
   if (PCR and (PCR != VPID.PID))
-     ss << '+' << IntToStr(PCR);
+     AppendParam(dest, '+', PCR);
 
   if (VPID.Type)
-     ss << '=' << IntToStr(VPID.Type);
-
-  if (APIDs.Count()) {
-     for(int i=0; i<APIDs.Count(); ++i) {
-        if (i == 0)
-           ss << ':';
-        else
-           ss << ',';
-        ss << IntToStr(APIDs[i].PID);
-        if (not APIDs[i].Lang.empty())
-           ss << '=' << APIDs[i].Lang;
-        if (APIDs[i].Type)
-           ss << '@' << IntToStr(APIDs[i].Type);
-        }
-     }
+     AppendParam(dest, '=', VPID.Type);
+
+  if (APIDs.Count())
+     AppendPids(dest, APIDs, ':');
   else
-     ss << ":0";
-
-  if (DPIDs.Count()) {
-     for(int i=0; i<DPIDs.Count(); ++i) {
-        if (i == 0)
-           ss << ';';
-        else
-           ss << ',';
-        ss << IntToStr(DPIDs[i].PID);
-        if (not DPIDs[i].Lang.empty())
-           ss << '=' << DPIDs[i].Lang;
-        if (DPIDs[i].Type)
-           ss << '@' << IntToStr(DPIDs[i].Type);
-        }
-     }
-  ss << ':' << IntToStr(TPID);
-  if (CAIDs.Count()) {
-     for(int i=0; i<CAIDs.Count(); ++i) {
-        if (i == 0)
-           ss << ':';
-        else
-           ss << ',';
-        ss << std::nouppercase << std::hex << CAIDs[i] << std::dec;
+     dest += ":0";
+
+  AppendPids(dest, DPIDs, ';');
+  AppendParam(dest, ':', TPID);
+
+  auto caids = CAIDs.Lock();
+  if (caids.Count()) {
+     for(int i=0; i<caids.Count(); ++i) {
+        dest += (i == 0) ? ':' : ',';
+        AppendHex(dest, caids[i]);
         }
      }
   else
-     ss << ":0";
-  ss << ':' << IntToStr(SID)
-     << ':' << IntToStr(ONID)
-     << ':' << IntToStr(TID)
-     << ':' << IntToStr(RID);
+     dest += ":0";
 
-  dest = std::move(ss.str());
+  AppendParam(dest, ':', SID);
+  AppendParam(dest, ':', ONID);
+  AppendParam(dest, ':', TID);
+  AppendParam(dest, ':', RID);
 }
 
 void TChannel::VdrChannel(cChannel& c) {
@@ -637,6 +662,113 @@ unsigned int GetFrontendStatus(cDevice* dev) {
   return status;
 }
 
+/* waits for a lock after tuning 'dev'. Instead of sleeping a fixed time, the
+ * frontend status is polled: returns true as soon as FE_HAS_LOCK is reported
+ * and confirmed by cDevice::HasLock(),
+ * false if neither signal nor carrier showed up within SignalWaitTime after the
+ * retune or no lock within SignalWaitTime + LockTimeout.
+ * VDR retunes in its tuner thread: the probe window starts, once the frontend
+ * frequency differs from 'Before', its value before SwitchChannel(). If it
+ * doesn't change (same frequency, other parameters), after a quarter of
+ * SignalWaitTime. Signal and carrier seen before are from the last channel.
+ * If 'Transponder' is given, the lock time is recorded and the timeout
+ * may be shortened to what was seen so far on this device type, see cLockProfiles.
+ * Devices without a dvb frontend (SAT>IP, ..) fall back to cDevice::HasLock().
+ */
+bool WaitForLock(cDevice* dev, const TChannel* Transponder, uint32_t Before) {
+  const int interval = 20;
+  const int probe    = wSetup.SignalWaitTime * 1000;
+  int timeout        = (wSetup.SignalWaitTime + wSetup.LockTimeout) * 1000;
+
+  cDvbDevice* dvbdevice = GetDvbDevice(dev);
+  if (dvbdevice == nullptr) {
+     mSleep(wSetup.SignalWaitTime * 1000);
+     return dev->HasLock(wSetup.LockTimeout * 1000);
+     }
+
+  bool learned = false;
+  if (Transponder) {
+     int ms = LockProfiles.Timeout(dev, Transponder);
+     if (ms > 0 and ms < timeout) {
+        timeout = ms;
+        learned = true;
+        }
+     }
+
+  std::string s = "/dev/dvb/adapter" + std::to_string(dvbdevice->Adapter()) +
+                  "/frontend"        + std::to_string(dvbdevice->Frontend());
+
+  int fe = open(s.c_str(), O_RDONLY | O_NONBLOCK);
+  if (fe < 0) {
+     dlog(0, "could not open " + s);
+     return false;
+     }
+
+  bool lock = false;
+  bool signal = false;
+  int retuned = -1;    // t of the retune, start of the probe window
+  int t;
+  for(t = 0; t < timeout; t += interval) {
+     if (retuned < 0 and (GetFrontendFrequency(dev) != Before or t >= probe / 4))
+        retuned = t;
+     fe_status_t status = FE_NONE;
+     if (IOCTL(fe, FE_READ_STATUS, &status) < 0) {
+        dlog(0, "could not read status: " + s);
+        break;
+        }
+     // right after SwitchChannel(), the frontend may still report the lock of the
+     // previous channel: confirm it by VDR's tuner, which was reset by SwitchChannel().
+     if ((status & FE_HAS_LOCK) and dev->HasLock(0)) {
+        lock = true;
+        break;
+        }
+     if (retuned >= 0) {
+        if (status & (FE_HAS_SIGNAL | FE_HAS_CARRIER))
+           signal = true;
+        else if (!signal and t >= retuned + probe)
+           break;
+        }
+     mSleep(interval);
+     }
+  close(fe);
+
+  // only lock times go to the profile. A learned timeout after signal or carrier
+  // may have been too short: that widens the next ones a bit.
+  if (Transponder and lock)
+     LockProfiles.Add(dev, Transponder, t);
+  else if (Transponder and signal and learned and t >= timeout)
+     LockProfiles.Miss(dev, Transponder);
+  return lock;
+}
+
+/* the frequency, the frontend of 'dev' is tuned to; 0 if unknown.
+ * Changes, as soon as VDR's tuner thread actually retuned after SwitchChannel().
+ */
+uint32_t GetFrontendFrequency(cDevice* dev) {
+  struct dtv_property p;
+  struct dtv_properties props;
+  std::memset(&p, 0, sizeof(p));
+  p.cmd = DTV_FREQUENCY;
+  props.num = 1;
+  props.props = &p;
+
+  cDvbDevice* dvbdevice = GetDvbDevice(dev);
+  if (dvbdevice == nullptr) return 0;
+
+  std::string s = "/dev/dvb/adapter" + std::to_string(dvbdevice->Adapter()) +
+                  "/frontend"        + std::to_string(dvbdevice->Frontend());
+
+  int fe = open(s.c_str(), O_RDONLY | O_NONBLOCK);
+  if (fe < 0)
+     dlog(0, "could not open " + s);
+  else {
+     if (IOCTL(fe, FE_GET_PROPERTY, &props) < 0)
+        dlog(0, "could not read frequency: " + s);
+     close(fe);
+     }
+  return p.u.data;
+}
+
 unsigned int GetCapabilities(cDevice* dev) {
   struct dvb_frontend_info fe_info;
   fe_info.caps = FE_IS_STUPID;
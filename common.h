@@ -7,11 +7,13 @@
 #include <array>
 #include <map>
 #include <utility> // std::move
+#include <mutex>
 #include <linux/types.h>
 #include <sys/ioctl.h>
 #include <vdr/diseqc.h>
 #include <repfunc.h>
 #include "tlist.h"
+#include "scanevent.h" // cScanEvent
 
 #define SCAN_TERRESTRIAL        0 /* DVB-T/T2                */
 #define SCAN_CABLE              1 /* DVB-C                   */
@@ -118,6 +120,27 @@ struct cell {
   struct transposer transposers[16];
 };
 
+/*******************************************************************************
+ * struct TTransponderKey, the tuning parameters of a TChannel as a small
+ * trivially copyable struct. Comparing transponders needs these only, without
+ * strings, pid lists and their mutexes.
+ ******************************************************************************/
+struct TTransponderKey {
+  char     Source[12];     // as TChannel::Source, zero terminated
+  int32_t  Frequency;      // FormatFreq(): S MHz, C,T,A kHz
+  int32_t  Symbolrate;
+  int16_t  Bandwidth;
+  int16_t  FEC;
+  int16_t  FEC_low;
+  int16_t  Guard;
+  int16_t  Modulation;
+  int16_t  Hierarchy;
+  int16_t  Transmission;
+  int16_t  StreamId;
+  int8_t   DelSys;
+  char     Polarization;
+};
+
 class TChannel {
 public:
   std::string Name;        // ':' replaced by '|', may contain ','
@@ -181,6 +204,7 @@ public:
   TChannel(void);
   TChannel& operator= (const cChannel* rhs);
   void CopyTransponderData(const TChannel* Channel);
+  TTransponderKey Key(void) const;
   void Params(std::string& s);
   void PrintTransponder(std::string& dest);
   void Print(std::string& dest);
@@ -193,6 +217,7 @@ public:
  * class TChannels
  ******************************************************************************/
 bool is_different_transponder_deep_scan(const TChannel* a, const TChannel* b, bool auto_allowed);
+bool is_different_transponder_deep_scan(const TTransponderKey& a, const TTransponderKey& b, bool auto_allowed);
 
 class TChannels : public TList<TChannel*> {
 public:
@@ -237,6 +262,9 @@ public:
   std::array<std::string,5> preferred;
   int SignalWaitTime;
   int LockTimeout;
+  int ParallelScan;
+  int SdtOther;
+  int PreSweep;
 public:
   cMySetup(void);
   void InitSystems(void);
@@ -265,6 +293,8 @@ void InitSystems(void);
 
 void PrintDvbApi(std::string& s);
 unsigned int GetFrontendStatus(cDevice* dev);
+bool WaitForLock(cDevice* dev, const TChannel* Transponder = nullptr, uint32_t Before = 0);
+uint32_t GetFrontendFrequency(cDevice* dev);
 bool GetTerrCapabilities (cDevice* dev, bool* CodeRate, bool* Modulation, bool* Inversion, bool* Bandwidth, bool* Hierarchy, bool* TransmissionMode, bool* GuardInterval, bool* DvbT2);
 bool GetCableCapabilities(cDevice* dev, bool* Modulation, bool* Inversion);
 bool GetAtscCapabilities (cDevice* dev, bool* Modulation, bool* Inversion, bool* VSB, bool* QAM);
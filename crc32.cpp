@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include "crc32.h"
+
+class TCrcTables {
+public:
+  uint32_t t[8][256];
+  TCrcTables(void) {
+     for(uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i << 24;
+        for(int bit = 0; bit < 8; bit++)
+           c = (c & 0x80000000) ? (c << 1) ^ 0x04C11DB7 : (c << 1);
+        t[0][i] = c;
+        }
+     for(int k = 1; k < 8; k++)
+        for(int i = 0; i < 256; i++)
+           t[k][i] = (t[k - 1][i] << 8) ^ t[0][t[k - 1][i] >> 24];
+     }
+};
+
+static const TCrcTables CrcTables;
+
+uint32_t Crc32(const unsigned char* Data, size_t Length, uint32_t Crc) {
+  const uint32_t (*t)[256] = CrcTables.t;
+
+  for(; Length >= 8; Length -= 8, Data += 8) {
+     uint32_t a = Crc ^ ((uint32_t) Data[0] << 24 | Data[1] << 16 | Data[2] << 8 | Data[3]);
+     Crc = t[7][a >> 24] ^ t[6][(a >> 16) & 0xFF] ^ t[5][(a >> 8) & 0xFF] ^ t[4][a & 0xFF] ^
+           t[3][Data[4]] ^ t[2][Data[5]] ^ t[1][Data[6]] ^ t[0][Data[7]];
+     }
+
+  while(Length--)
+     Crc = (Crc << 8) ^ t[0][(Crc >> 24) ^ *Data++];
+
+  return Crc;
+}
+
+bool SectionCrcValid(const unsigned char* Data, int Length) {
+  if (Length < 3 or (Data[1] & 0x80) == 0)
+     return false;
+  int size = 3 + ((Data[1] & 0x0F) << 8 | Data[2]);
+  if (size < 8 or size > Length)
+     return false;
+  return Crc32(Data, size) == 0;
+}
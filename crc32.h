@@ -0,0 +1,19 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <cstdint>      // uint32_t
+#include <cstddef>      // size_t
+
+/*******************************************************************************
+ * CRC-32/MPEG-2 of PSI/SI sections: polynomial 0x04C11DB7, not reflected,
+ * initial value 0xFFFFFFFF, no final xor. Computed eight bytes at a time
+ * (slice-by-8) instead of libsi's byte by byte loop.
+ * Over a whole section, including its CRC_32 field, the result is 0 if the
+ * section is valid.
+ ******************************************************************************/
+uint32_t Crc32(const unsigned char* Data, size_t Length, uint32_t Crc = 0xFFFFFFFF);
+
+// true, if section length and CRC of a section with section_syntax_indicator are valid.
+bool SectionCrcValid(const unsigned char* Data, int Length);
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <string>
+#include <cstdio>       // snprintf()
+#include <algorithm>    // std::min()
+
+/*******************************************************************************
+ * formatting of channel lines: numbers are appended to the caller's string,
+ * without stringstreams and temporary strings. A string reused for several
+ * channels doesn't allocate at all. The output is the same as IntToStr(),
+ * std::hex and FloatToStr(), see tests/format_check.cpp; for the times of
+ * both, see tests/format_bench.cpp.
+ ******************************************************************************/
+
+inline void AppendInt(std::string& dest, int n) {
+  char buf[12];
+  char* p = buf + sizeof(buf);
+  unsigned u = n < 0 ? 0U - (unsigned) n : (unsigned) n;
+  do {
+     *--p = '0' + u % 10;
+     u /= 10;
+     } while(u);
+  if (n < 0)
+     *--p = '-';
+  dest.append(p, buf + sizeof(buf) - p);
+}
+
+inline void AppendHex(std::string& dest, unsigned n) {  // lower case, as std::hex
+  static const char digits[] = "0123456789abcdef";
+  char buf[8];
+  char* p = buf + sizeof(buf);
+  do {
+     *--p = digits[n & 0xF];
+     n >>= 4;
+     } while(n);
+  dest.append(p, buf + sizeof(buf) - p);
+}
+
+inline void AppendParam(std::string& dest, char Param, int Value) {
+  dest += Param;
+  AppendInt(dest, Value);
+}
+
+// right aligned, as FloatToStr(Value, Width, Precision, false)
+inline void AppendFloat(std::string& dest, double Value, int Width, int Precision) {
+  char buf[64];
+  int n = snprintf(buf, sizeof(buf), "%*.*f", Width, Precision, Value);
+  if (n > 0)
+     dest.append(buf, std::min(n, (int) sizeof(buf) - 1));
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>      // std::min(), std::max()
+#include <vdr/device.h>   // cDevice
+#include "lockprofiles.h"
+#include "common.h"       // TChannel, DeviceName(), dlog(), wSetup
+
+cLockProfiles LockProfiles;
+
+// device name and delivery system, ie. "Sony CXD2880|T2 M999"
+std::string cLockProfiles::Key(cDevice* dev, const TChannel* Transponder) {
+  std::string key = DeviceName(dev) + '|' + Transponder->Source.substr(0,1);
+  if (Transponder->DelSys)
+     key += '2';
+  return key + " M" + IntToStr(Transponder->Modulation);
+}
+
+void cLockProfiles::Add(cDevice* dev, const TChannel* Transponder, int ms) {
+  const std::lock_guard<std::mutex> lock(m);
+  auto& h = profiles[Key(dev, Transponder)];
+  h[std::min(ms / BucketWidth, Buckets - 1)]++;
+  modified = true;
+}
+
+void cLockProfiles::Miss(cDevice* dev, const TChannel* Transponder) {
+  const std::lock_guard<std::mutex> lock(m);
+  int& n = misses[Key(dev, Transponder)];
+  n = std::min(n + 1, MaxMisses);
+}
+
+/* returns the timeout in ms for tuning 'Transponder' on 'dev': p99 of the lock
+ * times seen so far plus a margin and MissStep per miss, but never less than
+ * SignalWaitTime; 0, if there's not enough data yet.
+ */
+int cLockProfiles::Timeout(cDevice* dev, const TChannel* Transponder) {
+  const std::lock_guard<std::mutex> lock(m);
+  std::string key = Key(dev, Transponder);
+  auto it = profiles.find(key);
+  if (it == profiles.end())
+     return 0;
+
+  uint32_t samples = 0, sum = 0;
+  for(auto n:it->second)
+     samples += n;
+  if (samples < MinSamples)
+     return 0;
+
+  for(int i = 0; i < Buckets; i++) {
+     sum += it->second[i];
+     if (sum * 100 >= samples * 99) {
+        int p99 = (i + 1) * BucketWidth;
+        auto miss = misses.find(key);
+        int widen = (miss == misses.end()) ? 0 : miss->second * MissStep;
+        return std::max(p99 + std::max(p99 / 2, 250) + widen, wSetup.SignalWaitTime * 1000);
+        }
+     }
+  return 0;
+}
+
+/* file format, one line per profile:
+ * <key> '\t' <bucket>:<count> <bucket>:<count> ..
+ */
+void cLockProfiles::Load(std::string FileName) {
+  const std::lock_guard<std::mutex> lock(m);
+  std::ifstream f(FileName);
+  std::string line;
+
+  fileName = FileName;
+  profiles.clear();
+  while(std::getline(f, line)) {
+     size_t tab = line.find('\t');
+     if (tab == std::string::npos)
+        continue;
+     auto& h = profiles[line.substr(0, tab)];
+     h.fill(0);
+     std::stringstream ss(line.substr(tab + 1));
+     int bucket;
+     uint32_t count;
+     char colon;
+     while(ss >> bucket >> colon >> count) {
+        if (bucket >= 0 and bucket < Buckets)
+           h[bucket] = count;
+        }
+     }
+  modified = false;
+  dlog(5, "read " + IntToStr(profiles.size()) + " lock profiles from " + FileName);
+}
+
+void cLockProfiles::Save(void) {
+  const std::lock_guard<std::mutex> lock(m);
+  if (!modified or fileName.empty())
+     return;
+
+  std::ofstream f(fileName, std::ios::trunc);
+  if (!f) {
+     dlog(0, "could not write " + fileName);
+     return;
+     }
+  for(auto& p:profiles) {
+     f << p.first << '\t';
+     for(int i = 0; i < Buckets; i++)
+        if (p.second[i])
+           f << i << ':' << p.second[i] << ' ';
+     f << std::endl;
+     }
+  modified = false;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <string>
+#include <array>
+#include <map>
+#include <mutex>
+#include <cstdint>      // uint32_t
+
+class cDevice;
+class TChannel;
+
+/*******************************************************************************
+ * class cLockProfiles
+ * histograms of the lock times seen per device name and delivery system. Once
+ * enough locks were seen, the timeout for a tuning attempt is derived from them
+ * instead of using SignalWaitTime + LockTimeout.
+ * Timeouts after signal or carrier aren't lock times: they're only counted,
+ * for this session, and widen the learned timeout by a bounded step.
+ ******************************************************************************/
+class cLockProfiles {
+private:
+  static const int BucketWidth = 100;   // ms
+  static const int Buckets     = 150;   // 15s, max. SignalWaitTime + LockTimeout
+  static const int MinSamples  = 20;
+  static const int MissStep    = 250;   // ms, per miss
+  static const int MaxMisses   = 4;
+  typedef std::array<uint32_t, Buckets> THistogram;
+  std::mutex m;
+  std::map<std::string, THistogram> profiles;
+  std::map<std::string, int> misses;    // not saved
+  std::string fileName;
+  bool modified;
+  std::string Key(cDevice* dev, const TChannel* Transponder);
+public:
+  cLockProfiles(void) : modified(false) {}
+  void Add(cDevice* dev, const TChannel* Transponder, int ms);   // a lock after ms
+  void Miss(cDevice* dev, const TChannel* Transponder);          // timeout, maybe too short
+  int Timeout(cDevice* dev, const TChannel* Transponder);
+  void Load(std::string FileName);
+  void Save(void);
+};
+
+extern cLockProfiles LockProfiles;
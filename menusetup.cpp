@@ -7,6 +7,7 @@
 #include <array>
 #include <algorithm>    // std::min()
 #include <ctime>
+#include <mutex>
 #include <vdr/config.h>
 #include "menusetup.h"
 #include "common.h"
@@ -49,6 +50,7 @@ size_t lStrength = 0;
 size_t lStatus = 0;
 std::string lTransponder;
 std::string lDeviceName;
+std::mutex lMutex;
 time_t timestamp;
 
 
@@ -197,6 +199,9 @@ cMenuSettings::cMenuSettings(void) {
   Add(new cMenuEditBoolItem(tr("remove invalid channels"),   &wSetup.scan_remove_invalid));
   Add(new cMenuEditBoolItem(tr("update existing channels"),  &wSetup.scan_update_existing));
   Add(new cMenuEditBoolItem(tr("append new channels"),       &wSetup.scan_append_new));
+  Add(new cMenuEditBoolItem(tr("use all devices"),           &wSetup.ParallelScan));
+  Add(new cMenuEditBoolItem(tr("use SDT other"),             &wSetup.SdtOther));
+  Add(new cMenuEditBoolItem(tr("pre-sweep frequencies"),     &wSetup.PreSweep));
 }
 
 
@@ -4,6 +4,7 @@
  ******************************************************************************/
 #pragma once
 #include <string>
+#include <mutex>
 #include <vdr/menuitems.h>
 
 /*******************************************************************************
@@ -56,6 +57,7 @@ public:
 extern cMenuScanning* MenuScanning;
 extern std::string lDeviceName;
 extern std::string lTransponder;
+extern std::mutex lMutex;       // lDeviceName, lTransponder
 extern size_t lProgress;
 extern size_t lStrength;
 
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include "pmtpool.h"
+#include "scanevent.h"    // cScanEvent
+
+/*******************************************************************************
+ * cPmtPool
+ ******************************************************************************/
+
+cPmtPool::cWorker::cWorker(cPmtPool* Pool) : pool(Pool) {
+  Start();
+}
+
+void cPmtPool::cWorker::Action(void) {
+  cPmtJob* job;
+  while(Running() and (job = pool->Next()) != nullptr) {
+     job->Scan(buffer, sizeof(buffer));
+     pool->Done();
+     }
+}
+
+cPmtPool::cPmtPool(int Size, cScanEvent* Event) :
+  running(0), limit(Size), stop(false), jobs(0), event(Event)
+{
+  for(int i = 0; i < Size; i++)
+     workers.push_back(new cWorker(this));
+}
+
+cPmtPool::~cPmtPool() {
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  stop = true;
+  queue.clear();
+  }
+  cv.notify_all();
+  for(auto w:workers) {
+     while(w->Running())
+        mSleep(10);
+     delete w;
+     }
+}
+
+// blocks until a job may run; nullptr if the pool is deleted.
+cPmtJob* cPmtPool::Next(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [this]{ return stop or (queue.size() and running < limit); });
+  if (stop)
+     return nullptr;
+  cPmtJob* job = queue.front();
+  queue.pop_front();
+  running++;
+  return job;
+}
+
+void cPmtPool::Done(void) {
+  bool idle;
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  running--;
+  jobs++;
+  idle = (running == 0) and queue.empty();
+  }
+  cv.notify_one();
+  if (idle and event)
+     event->Signal();
+}
+
+void cPmtPool::Add(cPmtJob* Job) {
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  queue.push_back(Job);
+  }
+  cv.notify_one();
+}
+
+// starts more workers, if Limit is above the pool's size.
+void cPmtPool::SetLimit(int Limit) {
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  limit = Limit;
+  }
+  while((int) workers.size() < Limit)
+     workers.push_back(new cWorker(this));
+  cv.notify_all();
+}
+
+void cPmtPool::Clear(void) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  queue.clear();
+}
+
+int cPmtPool::Pending(void) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return queue.size() + running;
+}
+
+int cPmtPool::Jobs(void) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return jobs;
+}
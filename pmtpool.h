@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <vector>         // std::vector<>
+#include <deque>          // std::deque<>
+#include <mutex>          // std::mutex
+#include <condition_variable>
+#include <repfunc.h>      // ThreadBase
+
+class cScanEvent;
+
+/*******************************************************************************
+ * class cPmtJob
+ * reads and parses one PMT, using a worker's Buffer.
+ ******************************************************************************/
+class cPmtJob {
+public:
+  virtual ~cPmtJob() {}
+  virtual void Scan(unsigned char* Buffer, int Size) = 0;
+};
+
+
+/*******************************************************************************
+ * class cPmtPool
+ * worker threads, running cPmtJobs (cPmtScanner) one after another. Created
+ * once per state machine, instead of one thread per PMT; it grows up to the
+ * most PMTs read at the same time on one of its transponders.
+ ******************************************************************************/
+class cPmtPool {
+private:
+  class cWorker : public ThreadBase {
+  private:
+    cPmtPool* pool;
+    unsigned char buffer[4096];
+  protected:
+    virtual void Action(void);
+  public:
+    cWorker(cPmtPool* Pool);
+  };
+  std::vector<cWorker*> workers;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<cPmtJob*> queue;
+  int running;
+  int limit;
+  bool stop;
+  int jobs;
+  cScanEvent* event;
+  cPmtJob* Next(void);
+  void Done(void);
+public:
+  cPmtPool(int Size, cScanEvent* Event = nullptr);
+  ~cPmtPool();
+  void Add(cPmtJob* Job);
+  void SetLimit(int Limit);       // max. jobs running at the same time; grows the pool
+  void Clear(void);               // drops waiting jobs
+  int  Pending(void);             // waiting and running jobs; Event is signaled at zero
+  int  Size(void) { return workers.size(); };
+  int  Jobs(void);                // jobs done so far
+};
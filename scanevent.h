@@ -0,0 +1,33 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/*******************************************************************************
+ * class cScanEvent
+ * wakes up a waiting thread, ie. a state machine if one of its section scanners
+ * finished. A Signal() without a waiting thread is kept until the next Wait().
+ ******************************************************************************/
+class cScanEvent {
+private:
+  std::mutex m;
+  std::condition_variable cv;
+  bool signaled;
+public:
+  cScanEvent(void) : signaled(false) {}
+  void Signal(void) {
+     const std::lock_guard<std::mutex> lock(m);
+     signaled = true;
+     cv.notify_all();
+     }
+  bool Wait(int TimeoutMs) {                      // false on timeout
+     std::unique_lock<std::mutex> lock(m);
+     bool result = cv.wait_for(lock, std::chrono::milliseconds(TimeoutMs), [this]{ return signaled; });
+     signaled = false;
+     return result;
+     }
+};
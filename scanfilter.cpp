@@ -3,16 +3,26 @@
  * See the README file for copyright information and how to reach the author.
  ******************************************************************************/
 #include <string>
+#include <cstring>             // std::strcmp
 #include <vector>              // std::vector<>
-#include <algorithm>           // std::sort, std::unique
+#include <deque>               // std::deque<>
+#include <array>               // std::array<>
+#include <map>                 // std::map<>, std::multimap<>
+#include <unordered_map>       // std::unordered_multimap<>
+#include <algorithm>           // std::sort, std::includes
+#include <mutex>               // std::mutex
 #include <iostream>
 #include <cmath>               // round()
+#include <chrono>              // std::chrono::steady_clock
+#include <poll.h>              // poll()
 #include <vdr/device.h>        // cDevice
 #include <libsi/section.h>
 #include <libsi/descriptor.h>
 #include "scanfilter.h"
 #include "si_ext.h"
 #include "countries.h"         // COUNTRY::Alpha3()
+#include "sicache.h"           // SiCache
+#include "crc32.h"             // SectionCrcValid()
 
 
 /*******************************************************************************
@@ -28,64 +38,245 @@ extern TNitData NitData;
 TChannels NewChannels;
 TChannels NewTransponders;
 TChannels ScannedTransponders;
-std::vector<TChannelListItem> ChannelListItems;
+TArena<TChannel> ScanChannels;      // owns the TChannels of all lists above and of NIT data.
+static std::unordered_multimap<uint32_t, TChannelListItem> ChannelListItems; // by ServiceKey(), see GetLCN()
+static std::mutex ChannelListMutex; // ChannelListItems; NIT scanners of several devices.
+static std::unordered_multimap<uint32_t, int> SdtIndex;              // see MergeTables()
+static std::unordered_multimap<uint32_t, TChannel*> UnnamedChannels;
 
 int nextTransponders;
 
+/*******************************************************************************
+ * class TTransponderQueue, the untested part of NewTransponders.
+ * One deque per device: a state machine takes the transponders it found itself
+ * first (same network, in order) and steals from the tail of other devices'
+ * deques if its own one is empty. Devices without a running state machine
+ * take from the queue the same way, see cScanner::WaitForJobs().
+ ******************************************************************************/
+class TTransponderQueue {
+private:
+  struct TDeque {
+     std::mutex m;
+     std::deque<TChannel*> items;
+     };
+  std::array<TDeque, MAXDEVICES> deques;
+public:
+  void Push(TChannel* Transponder, int Owner) {
+     TDeque& d = deques[Owner % MAXDEVICES];
+     const std::lock_guard<std::mutex> lock(d.m);
+     d.items.push_back(Transponder);
+     }
+  TChannel* Pop(int Owner) {
+     for(size_t i = 0; i < deques.size(); i++) {
+        bool own = i == 0;
+        TDeque& d = deques[(Owner + i) % MAXDEVICES];
+        const std::lock_guard<std::mutex> lock(d.m);
+        if (d.items.empty())
+           continue;
+        TChannel* t;
+        if (own) {
+           t = d.items.front();
+           d.items.pop_front();
+           }
+        else {
+           t = d.items.back();
+           d.items.pop_back();
+           }
+        return t;
+        }
+     return nullptr;
+     }
+  void Clear(void) {
+     for(auto& d:deques) {
+        const std::lock_guard<std::mutex> lock(d.m);
+        d.items.clear();
+        }
+     }
+};
+
+static TTransponderQueue UntestedTransponders;
+
+
+/*******************************************************************************
+ * class TTransponderIndex, the transponders of a TChannels list, grouped by
+ * source (satellite: source, polarization and delivery system) and sorted by
+ * frequency. known_transponder() compares only those within the frequency
+ * tolerance, instead of the whole list. Each entry keeps a TTransponderKey
+ * copy, so a lookup doesn't touch the TChannels themselves.
+ ******************************************************************************/
+int FormatFreq(int f);
+static bool same_transponder(const TTransponderKey& newKey, const TTransponderKey& key, bool tunable, bool auto_allowed);
+
+class TTransponderIndex {
+private:
+  struct TEntry {
+     TTransponderKey key;
+     TChannel* channel;
+     };
+  typedef std::multimap<int, TEntry> TBucket;      // TTransponderKey::Frequency
+  std::mutex m;
+  std::map<std::string, TBucket> buckets;
+  std::map<const TChannel*, TTransponderKey> keys;
+  static std::string Group(const TTransponderKey& k) {
+     if (k.Source[0] == 'S')
+        return std::string(k.Source) + k.Polarization + IntToStr(k.DelSys);
+     return std::string(k.Source, 1);
+     }
+  void Insert(TChannel* t) {
+     TEntry e = { t->Key(), t };
+     buckets[Group(e.key)].insert(std::make_pair(e.key.Frequency, e));
+     keys[t] = e.key;
+     }
+  void Erase(const TChannel* t) {
+     auto k = keys.find(t);
+     if (k == keys.end())
+        return;
+     TBucket& b = buckets[Group(k->second)];
+     auto range = b.equal_range(k->second.Frequency);
+     for(auto it = range.first; it != range.second; ++it) {
+        if (it->second.channel == t) {
+           b.erase(it);
+           break;
+           }
+        }
+     keys.erase(k);
+     }
+public:
+  void Add(TChannel* t) {
+     const std::lock_guard<std::mutex> lock(m);
+     Insert(t);
+     }
+  // re-sorts t, after its tuning parameters changed; ignored if t isn't in the index.
+  void Update(TChannel* t) {
+     const std::lock_guard<std::mutex> lock(m);
+     if (keys.find(t) == keys.end())
+        return;
+     Erase(t);
+     Insert(t);
+     }
+  bool Find(const TTransponderKey& k, bool auto_allowed) {
+     const std::lock_guard<std::mutex> lock(m);
+     auto b = buckets.find(Group(k));
+     if (b == buckets.end())
+        return false;
+     // max. tolerance of is_nearly_same_frequency(): S MHz, C,T,A kHz
+     int delta = k.Source[0] == 'S' ? 2 : 2001;
+     auto last = b->second.upper_bound(k.Frequency + delta);
+     for(auto it = b->second.lower_bound(k.Frequency - delta); it != last; ++it)
+        if (same_transponder(k, it->second.key, it->second.channel->Tunable, auto_allowed))
+           return true;
+     return false;
+     }
+  void Clear(void) {
+     const std::lock_guard<std::mutex> lock(m);
+     buckets.clear();
+     keys.clear();
+     }
+};
+
+static TTransponderIndex NewTransponderIndex;
+static TTransponderIndex ScannedTransponderIndex;
+
 void resetLists(void) { 
   NewChannels.Clear();
   NewTransponders.Clear();
+  UntestedTransponders.Clear();
   ScannedTransponders.Clear();
+  NewTransponderIndex.Clear();
+  ScannedTransponderIndex.Clear();
   SdtData.services.Clear();
+  SdtData.complete_other.clear();
+  SdtIndex.clear();
+  UnnamedChannels.clear();
   NitData.frequency_list.Clear();
   NitData.cell_frequency_links.Clear();
+  NitData.cell_ids.clear();
   NitData.service_types.Clear();
-  for(int i = 0; i < NitData.transport_streams.Count(); i++)
-     delete NitData.transport_streams[i];
   NitData.transport_streams.Clear();
+  NitData.transport_stream_set.Clear();
   nextTransponders = 0;
 
+  if (ScanChannels.Count())
+     dlog(4, "released " + IntToStr(ScanChannels.Count()) + " channels and transponders of last scan");
+  ScanChannels.Clear();
+
   NewChannels.Capacity(2500);
   NewTransponders.Capacity(500);
   ScannedTransponders.Capacity(500);
 }
 
+void AddNewTransponder(TChannel* Transponder, int Owner) {
+  NewTransponders.Add(Transponder);
+  NewTransponderIndex.Add(Transponder);
+  UntestedTransponders.Push(Transponder, Owner);
+}
+
+void AddScannedTransponder(TChannel* Transponder) {
+  ScannedTransponders.Add(Transponder);
+  ScannedTransponderIndex.Add(Transponder);
+}
+
+void TransponderChanged(TChannel* Transponder) {
+  NewTransponderIndex.Update(Transponder);
+  ScannedTransponderIndex.Update(Transponder);
+}
+
+/* returns the next untested transponder from NewTransponders and marks it as
+ * tested, nullptr if none is left. Owner is the card index of the device,
+ * which is going to tune it.
+ */
+TChannel* NextTransponder(int Owner) {
+  TChannel* t = UntestedTransponders.Pop(Owner);
+  if (t)
+     t->Tested = true;
+  return t;
+}
+
+static bool nearly_same_frequency(const TTransponderKey& a, const TTransponderKey& b, unsigned delta = 2001) {
+  unsigned diff = (a.Frequency > b.Frequency) ? (a.Frequency - b.Frequency) : (b.Frequency - a.Frequency);
+  return diff <= delta;
+}
+
+static bool same_transponder(const TTransponderKey& newKey, const TTransponderKey& key, bool tunable, bool auto_allowed) {
+  if (newKey.Source[0] != key.Source[0])
+     return false;
+
+  char c = newKey.Source[0];
+  if (c == 'T') {
+     if (newKey.DelSys and (key.StreamId != newKey.StreamId))
+        return false; // may be multiple plps.
+     if (newKey.DelSys != key.DelSys and !tunable)
+        return false; // skip freqs with T!=T1, but not those which had success.
+     return nearly_same_frequency(key, newKey);
+     }
+  else if (c == 'C')
+     return nearly_same_frequency(key, newKey);
+  else if (c == 'A')
+     return nearly_same_frequency(key, newKey) && key.Modulation == newKey.Modulation;
+  else if (c == 'S')
+     return !is_different_transponder_deep_scan(newKey, key, auto_allowed);
+  else
+     dlog(0, std::string(__FUNCTION__) + ": source[0] = " + IntToHex((unsigned) c, 2));
+  return false;
+}
+
 bool known_transponder(TChannel* newChannel, bool auto_allowed, TChannels* list) {
   if (list == NULL) {
      return (known_transponder(newChannel, auto_allowed, &NewTransponders) ||
              known_transponder(newChannel, auto_allowed, &ScannedTransponders));
      }
 
-
-  for(int idx = 0; idx < list->Count(); ++idx) {
-     TChannel* channel = list->Items(idx);
-
-     if (newChannel->Source[0] != channel->Source[0])
-        continue;
-
-     char c = newChannel->Source[0];
-     if (c == 'T') {
-        if (newChannel->DelSys and (channel->StreamId != newChannel->StreamId))
-           continue; // may be multiple plps.
-        if (newChannel->DelSys != channel->DelSys and !channel->Tunable)
-           continue; // skip freqs with T!=T1, but not those which had success.
-        if (is_nearly_same_frequency(channel, newChannel))
-           return true;
-        }
-     else if (c == 'C') {
-        if (is_nearly_same_frequency(channel, newChannel))
-           return true;
-        }
-     else if (c == 'A') {
-       if (is_nearly_same_frequency(channel, newChannel) &&  channel->Modulation == newChannel->Modulation)
-          return true;
-       }
-     else if (c == 'S') {
-        if (!is_different_transponder_deep_scan(newChannel, channel, auto_allowed))
-           return true;
-        }
-     else
-        dlog(0, std::string(__FUNCTION__) + ": source[0] = " + IntToHex((unsigned) c, 2));
+  if (newChannel->Source.empty())
+     return false;
+  TTransponderKey key = newChannel->Key();
+  if (list == &NewTransponders)
+     return NewTransponderIndex.Find(key, auto_allowed);
+  if (list == &ScannedTransponders)
+     return ScannedTransponderIndex.Find(key, auto_allowed);
+
+  for(auto t:list->Lock()) {
+     if (same_transponder(key, t->Key(), t->Tunable, auto_allowed))
+        return true;
      }
   return (false);
 }
@@ -116,16 +307,20 @@ bool is_nearly_same_frequency(const TChannel* chan_a, const TChannel* chan_b, un
 }
 
 bool is_different_transponder_deep_scan(const TChannel* a, const TChannel* b, bool auto_allowed) {
+  return is_different_transponder_deep_scan(a->Key(), b->Key(), auto_allowed);
+}
+
+bool is_different_transponder_deep_scan(const TTransponderKey& a, const TTransponderKey& b, bool auto_allowed) {
   auto different = [](int a, int b, bool relaxed, int defValue) -> bool {
      if ((a == defValue) or (b == defValue))
         if (relaxed) return false;
      return a != b;
      };
 
-  if (a->Source != b->Source)
+  if (std::strcmp(a.Source, b.Source))
      return true;
 
-  char asource = a->Source[0];
+  char asource = a.Source[0];
   int maxdelta = 500; //kHz
 
   if (asource == 'S')
@@ -134,79 +329,587 @@ bool is_different_transponder_deep_scan(const TChannel* a, const TChannel* b, bo
      maxdelta = 250; //kHz -> France
 
 
-  if (!is_nearly_same_frequency(a, b, maxdelta))
+  if (!nearly_same_frequency(a, b, maxdelta))
      return true;
 
   switch(asource) {
      case 'T': {
-        if (different(a->Modulation, b->Modulation, auto_allowed, 999))
+        if (different(a.Modulation, b.Modulation, auto_allowed, 999))
            return true;
-        if (different(a->Bandwidth, b->Bandwidth, auto_allowed, 8))
+        if (different(a.Bandwidth, b.Bandwidth, auto_allowed, 8))
            return true;
-        if (different(a->FEC, b->FEC, auto_allowed, 999))
+        if (different(a.FEC, b.FEC, auto_allowed, 999))
            return true;
-        if (different(a->Hierarchy, b->Hierarchy, auto_allowed, 999))
+        if (different(a.Hierarchy, b.Hierarchy, auto_allowed, 999))
            return true;
-        if (different(a->FEC_low, b->FEC_low, auto_allowed, 999))
+        if (different(a.FEC_low, b.FEC_low, auto_allowed, 999))
            return true;
-        if (different(a->Transmission, b->Transmission, auto_allowed, 999))
+        if (different(a.Transmission, b.Transmission, auto_allowed, 999))
            return true;
-        if (different(a->Guard, b->Guard, auto_allowed, 999))
+        if (different(a.Guard, b.Guard, auto_allowed, 999))
            return true;
-        if (different(a->DelSys, b->DelSys, false, 0))
+        if (different(a.DelSys, b.DelSys, false, 0))
            return true;
         return false;
         }
      case 'A': {
-        if (different(a->Modulation, b->Modulation, auto_allowed, 999))
+        if (different(a.Modulation, b.Modulation, auto_allowed, 999))
            return true;
         return false;
         }
      case 'C': {
-        if (different(a->Modulation, b->Modulation, auto_allowed, 999))
+        if (different(a.Modulation, b.Modulation, auto_allowed, 999))
            return true;
-        if (different(a->Symbolrate, b->Symbolrate, false, 6900))
+        if (different(a.Symbolrate, b.Symbolrate, false, 6900))
            return true;
-        if (different(a->FEC, b->FEC, auto_allowed, 999))
+        if (different(a.FEC, b.FEC, auto_allowed, 999))
            return true;
-        if (different(a->DelSys, b->DelSys, false, 0))
+        if (different(a.DelSys, b.DelSys, false, 0))
            return true;
         return false;
         }
      case 'S': {
-        if (different(a->Symbolrate, b->Symbolrate, false, -1))
+        if (different(a.Symbolrate, b.Symbolrate, false, -1))
            return true;
-        if (different(a->Polarization, b->Polarization, false, 0))
+        if (different(a.Polarization, b.Polarization, false, 0))
            return true;
-        if (different(a->FEC, b->FEC, auto_allowed, 999))
+        if (different(a.FEC, b.FEC, auto_allowed, 999))
            return true;
-        if (different(a->DelSys, b->DelSys, false, 0))
+        if (different(a.DelSys, b.DelSys, false, 0))
            return true;
-        if (a->DelSys == 1) {
-           //if (different(a->Rolloff, b->Rolloff, auto_allowed, 999)) {
-           //   std::cout << "a->Rolloff = " << std::to_string(a->Rolloff) << ", b->Rolloff = " << std::to_string(b->Rolloff) << std::endl;
+        if (a.DelSys == 1) {
+           //if (different(a.Rolloff, b.Rolloff, auto_allowed, 999)) {
+           //   std::cout << "a.Rolloff = " << std::to_string(a.Rolloff) << ", b.Rolloff = " << std::to_string(b.Rolloff) << std::endl;
            //   return true;
            //   }
-           if (different(a->Modulation, b->Modulation, auto_allowed, 999))
+           if (different(a.Modulation, b.Modulation, auto_allowed, 999))
               return true;
-           if (a->StreamId != b->StreamId)
+           if (a.StreamId != b.StreamId)
               return true;
            }
         return false;
         }
      default:
-        dlog(0, std::string(__FUNCTION__) + ": unknown source type '" + a->Source + "'");
+        dlog(0, std::string(__FUNCTION__) + ": unknown source type '" + std::string(a.Source) + "'");
+     }
+  return true;
+}
+
+
+/*******************************************************************************
+ * class TTransportStreamSet
+ ******************************************************************************/
+// the frequency of PrintTransponder() in 1/100 MHz: equal, if printed equal.
+static uint64_t PrintedFrequency(const TChannel* t) {
+  char buf[32];
+  int i = FormatFreq(t->Frequency);
+  if (t->Source[0] == 'S')
+     return i * 100ULL;
+  snprintf(buf, sizeof(buf), "%.2f", i/1000.0);
+  uint64_t f = 0;
+  for(const char* p = buf; *p; p++)
+     if (*p >= '0' and *p <= '9')
+        f = 10 * f + (*p - '0');
+  return f;
+}
+
+uint64_t TTransportStreamSet::Hash(const TChannel* t) {
+  uint64_t h = t->TID;
+  h = (h << 8) | (uint8_t) t->Source[0];
+  h = (h << 1) | (t->DelSys == 1);
+  h = h * 0x9E3779B97F4A7C15ULL + PrintedFrequency(t);
+  if (t->Source[0] == 'C' or t->Source[0] == 'S')
+     h = h * 0x9E3779B97F4A7C15ULL + FormatFreq(t->Symbolrate);
+  return h;
+}
+
+bool TTransportStreamSet::Same(const TChannel* a, const TChannel* b) {
+  if (a->TID != b->TID or (a->NID != b->NID and a->ONID != b->ONID))
+     return false;
+  // the fields of PrintTransponder()
+  char source = a->Source[0];
+  if (source != b->Source[0] or (a->DelSys == 1) != (b->DelSys == 1) or
+      PrintedFrequency(a) != PrintedFrequency(b))
+     return false;
+  if (source != 'C' and source != 'S')
+     return true;
+  if (FormatFreq(a->Symbolrate) != FormatFreq(b->Symbolrate))
+     return false;
+  // TChannel::Params() of C and S
+  if (a->FEC != b->FEC or a->Inversion != b->Inversion or a->Modulation != b->Modulation)
+     return false;
+  if (source == 'C')
+     return true;
+  if (a->Polarization != b->Polarization or a->DelSys != b->DelSys)
+     return false;
+  return !a->DelSys or
+         (a->Pilot == b->Pilot and a->Rolloff == b->Rolloff and a->StreamId == b->StreamId);
+}
+
+bool TTransportStreamSet::Contains(TChannel* t, bool SameCells) const {
+  auto range = items.equal_range(Hash(t));
+  for(auto it = range.first; it != range.second; ++it)
+     if (Same(t, it->second) and (!SameCells or t->cells.Count() == it->second->cells.Count()))
+        return true;
+  return false;
+}
+
+void TTransportStreamSet::Add(TChannel* t) {
+  items.insert(std::make_pair(Hash(t), t));
+}
+
+
+/*******************************************************************************
+ * MergeTables(), ClearTables(): NIT and SDT of one transponder are collected by
+ * each state machine on its own and merged into NitData and SdtData afterwards.
+ * SdtIndex finds the services of SdtData by TID and SID; UnnamedChannels are
+ * NewChannels waiting for their service. Like SdtData, both are used with the
+ * tables locked only.
+ ******************************************************************************/
+static inline uint32_t ServiceKey(int TID, int SID) {
+  return ((uint32_t) TID << 16) | (SID & 0xFFFF);
+}
+
+int FindSdtService(int TID, int SID) {
+  int first = -1;
+  auto range = SdtIndex.equal_range(ServiceKey(TID, SID));
+  for(auto it = range.first; it != range.second; ++it)
+     if (first < 0 or it->second < first)
+        first = it->second;
+  return first;
+}
+
+void AddUnnamedChannel(TChannel* Channel) {
+  UnnamedChannels.insert(std::make_pair(ServiceKey(Channel->TID, Channel->SID), Channel));
+}
+
+static void NameChannels(const sdtservice& Service) {
+  auto range = UnnamedChannels.equal_range(ServiceKey(Service.transport_stream_id, Service.service_id));
+  for(auto it = range.first; it != range.second; ++it) {
+     TChannel* c = it->second;
+     c->Name         = Service.Name;
+     c->Shortname    = Service.Shortname;
+     c->Provider     = Service.Provider;
+     c->free_CA_mode = Service.free_CA_mode;
+     if (wSetup.verbosity > 4) {
+        std::string s;
+        c->Print(s);
+        dlog(5, "Update: '" + s + "'");
+        }
+     }
+  UnnamedChannels.erase(range.first, range.second);
+}
+
+void MergeTables(TNitData& Nit, TSdtData& Sdt) {
+  for(auto t:Nit.transport_streams.Lock()) {
+     if (NitData.transport_stream_set.Contains(t))
+        ScanChannels.Free(t);
+     else {
+        NitData.transport_streams.Add(t);
+        NitData.transport_stream_set.Add(t);
+        }
+     }
+  Nit.transport_streams.Clear();
+  Nit.transport_stream_set.Clear();
+
+  for(int i = 0; i < Sdt.services.Count(); i++) {
+     sdtservice& service = Sdt.services[i];
+     uint32_t key = ServiceKey(service.transport_stream_id, service.service_id);
+     bool found = false;
+     auto range = SdtIndex.equal_range(key);
+     for(auto it = range.first; !found and it != range.second; ++it)
+        found = SdtData.services[it->second].original_network_id == service.original_network_id;
+     if (!found) {
+        SdtIndex.insert(std::make_pair(key, SdtData.services.Count()));
+        SdtData.services.Add(service);
+        NameChannels(service);
+        }
+     }
+  Sdt.services.Clear();
+  SdtData.complete_other.insert(Sdt.complete_other.begin(), Sdt.complete_other.end());
+  Sdt.complete_other.clear();
+}
+
+void ClearTables(TNitData& Nit, TSdtData& Sdt) {
+  for(auto t:Nit.transport_streams.Lock())
+     ScanChannels.Free(t);
+  Nit.transport_streams.Clear();
+  Nit.transport_stream_set.Clear();
+  Nit.frequency_list.Clear();
+  Nit.cell_frequency_links.Clear();
+  Nit.cell_ids.clear();
+  Nit.service_types.Clear();
+  Sdt.services.Clear();
+  Sdt.complete_other.clear();
+  Sdt.original_network_id = 0;
+}
+
+
+/*******************************************************************************
+ * cScanReceiver
+ ******************************************************************************/
+
+cScanReceiver::cScanReceiver(cDevice* Device, const std::vector<int>& Pids) :
+  cReceiver(nullptr, 99), device(Device), nextHandle(0) {
+  for(auto pid:Pids) {
+     if (pids.size() >= MAXRECEIVEPIDS)
+        break;
+     TPidState state;
+     state.cc = -1;
+     state.reserved = true;
+     pids[pid] = state;
+     }
+  // not attached yet: no Apply() needed. Subscribing to these later doesn't
+  // re-attach the receiver.
+  for(auto& p:pids) {
+     AddPid(p.first);
+     applied.push_back(p.first);
+     }
+}
+
+cScanReceiver::~cScanReceiver() {
+  cReceiver::Detach();
+}
+
+int cScanReceiver::Subscribe(int Pid, int Tid, int Mask, TSectionHandler Handler) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (pids.find(Pid) == pids.end()) {
+     if (pids.size() >= MAXRECEIVEPIDS)
+        return -1;
+     TPidState state;
+     state.cc = -1;
+     state.reserved = false;
+     pids[Pid] = state;
+     }
+  TSubscription sub;
+  sub.Pid     = Pid;
+  sub.Tid     = Tid;
+  sub.Mask    = Mask;
+  sub.Handler = Handler;
+  subscriptions[nextHandle] = sub;
+  return nextHandle++;
+}
+
+void cScanReceiver::Unsubscribe(int Handle) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = subscriptions.find(Handle);
+  if (it == subscriptions.end())
+     return;
+  int pid = it->second.Pid;
+  subscriptions.erase(it);
+  for(auto& sub:subscriptions)
+     if (sub.second.Pid == pid)
+        return;
+  auto p = pids.find(pid);
+  if (p == pids.end() or p->second.reserved)
+     return;
+  // the device keeps sending this pid until the next Apply(); Receive() drops it.
+  pids.erase(p);
+}
+
+int cScanReceiver::Reserve(const std::vector<int>& Pids) {
+  int added = 0;
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  for(auto pid:Pids) {
+     auto it = pids.find(pid);
+     if (it != pids.end()) {
+        it->second.reserved = true;
+        continue;
+        }
+     if (pids.size() >= MAXRECEIVEPIDS)
+        break;
+     TPidState state;
+     state.cc = -1;
+     state.reserved = true;
+     pids[pid] = state;
+     added++;
+     }
+  }
+  Apply();
+  return added;
+}
+
+bool cScanReceiver::Apply(void) {
+  const std::lock_guard<std::mutex> apply(applyMutex);
+  std::vector<int> wanted;
+  {
+  const std::lock_guard<std::mutex> lock(mutex);
+  for(auto& p:pids)
+     wanted.push_back(p.first);
+  }
+  // pids no longer wanted may stay with the device, Receive() drops them.
+  if (std::includes(applied.begin(), applied.end(), wanted.begin(), wanted.end()))
+     return true;
+
+  // the pids of an attached receiver are fixed, as vdr sets up the device's
+  // pid filters in AttachReceiver(); re-attach with the new set.
+  // Continuity counters and incomplete sections are kept: packets lost
+  // meanwhile show up as a continuity error, which only drops the section
+  // of that pid.
+  device->Detach(this);
+  SetPids(nullptr);
+  for(auto pid:wanted)
+     AddPid(pid);
+  applied = wanted;
+  if (!device->AttachReceiver(this)) {
+     dlog(0, "cScanReceiver: could not attach receiver");
+     return false;
+     }
+  return true;
+}
+
+int cScanReceiver::FreePids(void) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return MAXRECEIVEPIDS - pids.size();
+}
+
+void cScanReceiver::Receive(const uchar* Data, int Length) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  for(; Length >= TS_SIZE; Data += TS_SIZE, Length -= TS_SIZE) {
+     if (Data[0] != TS_SYNC_BYTE or (Data[1] & 0x80)) // no sync or transport error
+        continue;
+     int pid = ((Data[1] & 0x1F) << 8) | Data[2];
+     auto it = pids.find(pid);
+     if (it == pids.end() or (Data[3] & 0x10) == 0)   // not subscribed or no payload
+        continue;
+
+     TPidState& state = it->second;
+     int cc = Data[3] & 0x0F;
+     if (cc == state.cc)                              // duplicate packet
+        continue;
+     if (state.cc >= 0 and cc != ((state.cc + 1) & 0x0F))
+        state.section.clear();                        // packet loss, drop incomplete section
+     state.cc = cc;
+
+     int offset = 4;
+     if (Data[3] & 0x20)                              // adaption field
+        offset += 1 + Data[4];
+     if (offset >= TS_SIZE)
+        continue;
+     const unsigned char* p = Data + offset;
+     int len = TS_SIZE - offset;
+
+     if (Data[1] & 0x40) {                            // payload unit start
+        int pointer = *p++;
+        len--;
+        if (pointer > len) {
+           state.section.clear();
+           continue;
+           }
+        if (state.section.size())                     // end of the previous section
+           Append(state, pid, p, pointer);
+        state.section.clear();
+        p += pointer;
+        len -= pointer;
+        while((len > 0) and (*p != 0xFF)) {            // 0xFF: stuffing
+           int n = Append(state, pid, p, len);
+           p += n;
+           len -= n;
+           if (state.section.size())                  // continues in the next packet
+              break;
+           }
+        }
+     else if (state.section.size())
+        Append(state, pid, p, len);
+     }
+}
+
+// appends up to one section, returns the number of bytes used.
+int cScanReceiver::Append(TPidState& State, int Pid, const unsigned char* Data, int Length) {
+  int used = 0;
+  if (State.section.size() < 3) {
+     used = std::min(3 - (int) State.section.size(), Length);
+     State.section.insert(State.section.end(), Data, Data + used);
+     if (State.section.size() < 3)
+        return used;
+     }
+
+  int size = 3 + (((State.section[1] & 0x0F) << 8) | State.section[2]);
+  if (size > 4096) {
+     State.section.clear();
+     return Length;
+     }
+
+  int n = std::min(size - (int) State.section.size(), Length - used);
+  State.section.insert(State.section.end(), Data + used, Data + used + n);
+  used += n;
+
+  if ((int) State.section.size() == size) {
+     Dispatch(Pid, State.section.data(), size);
+     State.section.clear();
+     }
+  return used;
+}
+
+void cScanReceiver::Dispatch(int Pid, const unsigned char* Data, int Length) {
+  for(auto& sub:subscriptions) {
+     if (sub.second.Pid == Pid and (sub.second.Tid < 0 or sub.second.Tid == (Data[0] & sub.second.Mask)))
+        sub.second.Handler(Data, Length);
+     }
+}
+
+
+/*******************************************************************************
+ * cSectionFilter
+ ******************************************************************************/
+
+cSectionFilter::cSectionFilter(cDevice* Device, cScanReceiver* Receiver, int Pid, int Tid, int Mask) :
+  device(Device), receiver(nullptr), fd(-1), handle(-1)
+{
+  if (Receiver) {
+     handle = Receiver->Subscribe(Pid, Tid, Mask, [this](const unsigned char* Data, int Length) {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (sections.size() < 64)
+           sections.emplace_back(Data, Data + Length);
+        cv.notify_one();
+        });
+     if (handle >= 0) {
+        receiver = Receiver;
+        receiver->Apply();   // no re-attach for a PID given to the ctor or Reserve() before
+        return;
+        }
+     }
+  fd = device->OpenFilter(Pid, Tid, Mask);
+}
+
+cSectionFilter::~cSectionFilter() {
+  if (receiver)
+     receiver->Unsubscribe(handle);
+  else
+     device->CloseFilter(fd);
+}
+
+int cSectionFilter::Read(unsigned char* Buffer, int Size, int TimeoutMs) {
+  if (receiver) {
+     std::unique_lock<std::mutex> lock(mutex);
+     if (!cv.wait_for(lock, std::chrono::milliseconds(TimeoutMs), [this]{ return !sections.empty(); }))
+        return 0;
+     int len = std::min((int) sections.front().size(), Size);
+     memcpy(Buffer, sections.front().data(), len);
+     sections.pop_front();
+     return len;
+     }
+
+  struct pollfd pfd;
+  pfd.fd      = fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, TimeoutMs) <= 0 or (pfd.revents & POLLIN) == 0)
+     return 0;
+  return std::max(0, (int) device->ReadFilter(fd, Buffer, Size));
+}
+
+
+/*******************************************************************************
+ * the scanners wait in cSectionFilter::Read() at most 100ms, to check their
+ * timeouts and stop requests.
+ ******************************************************************************/
+
+static int Elapsed(std::chrono::steady_clock::time_point Start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Start).count();
+}
+
+
+/*******************************************************************************
+ * cSectionBitmap
+ ******************************************************************************/
+
+bool cSectionBitmap::Add(int TableId, int Extension, int Version, int Section, int LastSection) {
+  TSubTable& t = tables[(TableId << 16) | Extension];
+  if (t.seen.none() or t.version != Version or t.last != LastSection) {
+     t.version = Version;
+     t.last    = LastSection;
+     t.seen.reset();
      }
+  if (Section > LastSection or t.seen.test(Section))
+     return false;
+  t.seen.set(Section);
   return true;
 }
 
+bool cSectionBitmap::Complete(void) {
+  if (tables.empty())
+     return false;
+  for(auto& t:tables)
+     if ((int) t.second.seen.count() != t.second.last + 1)
+        return false;
+  return true;
+}
+
+bool cSectionBitmap::Complete(int TableId) {
+  bool any = false;
+  for(auto& t:tables) {
+     if ((int) (t.first >> 16) != TableId)
+        continue;
+     if ((int) t.second.seen.count() != t.second.last + 1)
+        return false;
+     any = true;
+     }
+  return any;
+}
+
+bool cSectionBitmap::Complete(int TableId, int Extension) {
+  auto t = tables.find(TableId << 16 | Extension);
+  return t != tables.end() and (int) t->second.seen.count() == t->second.last + 1;
+}
+
+
+/*******************************************************************************
+ * class TSection, a libsi section, which checks its CRC by SectionCrcValid()
+ * instead of libsi's byte by byte CRC.
+ ******************************************************************************/
+template<class T> class TSection : public T {
+private:
+  const unsigned char* raw;
+public:
+  TSection(const unsigned char* Data) : T(Data, false), raw(Data) {}
+  bool CheckCRCAndParse(int Length) {
+     if (!SectionCrcValid(raw, Length))
+        return false;
+     this->CheckParse();
+     return this->isValid();
+     }
+};
+
+
+/*******************************************************************************
+ * cSectionRepeats
+ ******************************************************************************/
+bool cSectionRepeats::Key(const unsigned char* Data, int Length, uint64_t& Key, uint32_t& Crc) {
+  if (Length < 12 or (Data[1] & 0x80) == 0) // no section_syntax_indicator: no version, no CRC.
+     return false;
+  Key = (uint64_t) Data[0] << 32 |                 // table_id
+        (uint32_t) Data[3] << 24 | Data[4] << 16 | // table_id_extension
+        (Data[5] & 0x3F) << 8 |                    // version_number, current_next_indicator
+        Data[6];                                   // section_number
+  Crc = (uint32_t) Data[Length - 4] << 24 | Data[Length - 3] << 16 | Data[Length - 2] << 8 | Data[Length - 1];
+  return true;
+}
+
+bool cSectionRepeats::Known(const unsigned char* Data, int Length) {
+  uint64_t key;
+  uint32_t crc;
+  if (!Key(Data, Length, key, crc))
+     return false;
+  auto it = crcs.find(key);
+  return it != crcs.end() and it->second == crc;
+}
+
+void cSectionRepeats::Add(const unsigned char* Data, int Length) {
+  uint64_t key;
+  uint32_t crc;
+  if (Key(Data, Length, key, crc))
+     crcs[key] = crc;
+}
+
 
 /*******************************************************************************
  * cPatScanner
  ******************************************************************************/
 
-cPatScanner::cPatScanner(cDevice* Parent, struct TPatData& Dest) :
-  device(Parent), PatData(Dest), isActive(true), hasPAT(false), anyBytes(false)
+cPatScanner::cPatScanner(cDevice* Parent, struct TPatData& Dest, cScanReceiver* Receiver, cScanEvent* Event) :
+  device(Parent), receiver(Receiver), PatData(Dest), isActive(true), event(Event), hasPAT(false), anyBytes(false)
 {
   PatData.services.Clear();
   PatData.network_PID = 0;
@@ -217,29 +920,26 @@ cPatScanner::cPatScanner(cDevice* Parent, struct TPatData& Dest) :
 
 cPatScanner::~cPatScanner() {
   isActive = false;
-  wait.Signal();
 }
 
 void cPatScanner::Action(void) {
-  int count = 0;
+  cScanEvent* done = event; // 'this' may be deleted once inactive.
+  auto start = std::chrono::steady_clock::now();
   int nbytes = 0;
-  int fd = device->OpenFilter(SI_EXT::PID_PAT, SI_EXT::TABLE_ID_PAT, 0xFF);
+  cSectionFilter filter(device, receiver, SI_EXT::PID_PAT, SI_EXT::TABLE_ID_PAT);
   unsigned char buffer[4096];
 
   while(Running() && isActive) {
-     if (wait.Wait(10)) {
-        dlog(5, "cPatScanner: received signal");
-        break;
-        }
-     if (count++ > 1000) { // > 10sec
+     int ms = Elapsed(start);
+     if (ms > 10000) {
         dlog(5, "cPatScanner: PAT timeout.");
         break;
         }
-     else if ((count > 300) and not(anyBytes)) {
+     else if ((ms > 3000) and not(anyBytes)) {
         dlog(5, "cPatScanner: PAT timeout.");
         break;
         }
-     nbytes = device->ReadFilter(fd, buffer, sizeof(buffer));
+     nbytes = filter.Read(buffer, sizeof(buffer), 100);
      if (nbytes > 0) {
         anyBytes = true;
         Process(buffer, nbytes);
@@ -248,15 +948,17 @@ void cPatScanner::Action(void) {
         break;
      }
 
-  device->CloseFilter(fd);
-  fd = -1;
   isActive = false;
+  if (done) done->Signal();
 }
 
 
 void cPatScanner::Process(const unsigned char* Data, int Length) {
-  SI::PAT tsPAT(Data, false);
-  if (!tsPAT.CheckCRCAndParse()) {
+  if (repeats.Known(Data, Length))
+     return;
+
+  TSection<SI::PAT> tsPAT(Data);
+  if (!tsPAT.CheckCRCAndParse(Length)) {
      hexdump("PAT CRC error", Data, Length);
      return;
      }
@@ -265,6 +967,7 @@ void cPatScanner::Process(const unsigned char* Data, int Length) {
      dlog(4, "cPatScanner: wait for PAT Sync");
      return;
      }
+  repeats.Add(Data, Length);  // after Sync(): a section out of order is taken on its next repetition.
 
   if (wSetup.verbosity > 5)
      hexdump("PAT", Data, Length);
@@ -294,8 +997,8 @@ void cPatScanner::Process(const unsigned char* Data, int Length) {
  * cPmtScanner
  ******************************************************************************/
 
-cPmtScanner::cPmtScanner(cDevice* Parent, TPmtData* Data) :
-  device(Parent), data(Data), isActive(false), jobDone(false)
+cPmtScanner::cPmtScanner(cDevice* Parent, TPmtData* Data, cScanReceiver* Receiver) :
+  device(Parent), receiver(Receiver), data(Data), isActive(true), jobDone(false)
 {
   data->program_number = 0;
   data->PCR_PID = 0;
@@ -309,39 +1012,31 @@ cPmtScanner::cPmtScanner(cDevice* Parent, TPmtData* Data) :
 
 cPmtScanner::~cPmtScanner() {
   isActive = false;
-  wait.Signal();
 }
 
-void cPmtScanner::Action(void) {
-  isActive = true;
-  int count = 0;
+void cPmtScanner::Scan(unsigned char* Buffer, int Size) {
+  auto start = std::chrono::steady_clock::now();
   int nbytes = 0;
-  int fd = device->OpenFilter(data->program_map_PID, SI_EXT::TABLE_ID_PMT, 0xFF);
-  unsigned char buffer[4096];
+  cSectionFilter filter(device, receiver, data->program_map_PID, SI_EXT::TABLE_ID_PMT);
 
-  while (Running() && isActive) {
-     if (wait.Wait(10)) {
-        break;
-        }
-     if (count++ > 500) { //>5sec
+  while(isActive) {
+     if (Elapsed(start) > 5000) {
         isActive = false;
         break;
         }
-     nbytes = device->ReadFilter(fd, buffer, sizeof(buffer));
+     nbytes = filter.Read(Buffer, Size, 100);
      if (nbytes > 0)
-        Process(buffer, nbytes);
+        Process(Buffer, nbytes);
      }
 
-  device->CloseFilter(fd);
-  fd = -1;
   jobDone = true;
   isActive = false;
 }
 
 void cPmtScanner::Process(const unsigned char* Data, int Length) {
 
-  SI::PMT pmt(Data, false);
-  if (!pmt.CheckCRCAndParse()/* || (pmt.getServiceId() != pmtSid)*/)
+  TSection<SI::PMT> pmt(Data);
+  if (!pmt.CheckCRCAndParse(Length)/* || (pmt.getServiceId() != pmtSid)*/)
      return;
 
   data->program_number = pmt.getServiceId();
@@ -506,12 +1201,10 @@ void cPmtScanner::Process(const unsigned char* Data, int Length) {
  * basically this is cNitFilter from older vdr/nit.{h,c} with some changes
  ******************************************************************************/
 
-cNitScanner::cNitScanner(cDevice* Parent, uint16_t network_PID, TNitData& Data, int Type) :
-  active(true), device(Parent), nit(network_PID), data(Data), type(Type), hasNIT(false),
+cNitScanner::cNitScanner(cDevice* Parent, uint16_t network_PID, TNitData& Data, int Type, cScanReceiver* Receiver, cScanEvent* Event) :
+  active(true), device(Parent), receiver(Receiver), nit(network_PID), event(Event), data(Data), type(Type), hasNIT(false),
   anyBytes(false)
 {
-  first_crc32 = 0;
-
   west = Data.West;
   orbital = Data.OrbitalPos;
   Start();
@@ -519,44 +1212,35 @@ cNitScanner::cNitScanner(cDevice* Parent, uint16_t network_PID, TNitData& Data,
 
 cNitScanner::~cNitScanner() {
   active = false;
-  wait.Signal();
 }
 
 void cNitScanner::Action(void) {
-  int count = 0;
+  cScanEvent* done = event;
+  auto start = std::chrono::steady_clock::now();
   int nbytes = 0;
-  int fd = device->OpenFilter(nit, SI_EXT::TABLE_ID_NIT_ACTUAL, 0xFF);
+  cSectionFilter filter(device, receiver, nit, SI_EXT::TABLE_ID_NIT_ACTUAL);
   unsigned char buffer[4096];
-  size_t items = ChannelListItems.size();
 
   while(Running() && active) {
-     if (wait.Wait(10)) {
-        break;
-        }
-     if (count++ > 4000) {   // 4000 x 10msec = 40sec
+     int ms = Elapsed(start);
+     if (ms > 40000) {
         dlog(2, "NIT timeout");
         break;
         }
-     else if ((count > 1800) and not(anyBytes))
+     else if ((ms > 18000) and not(anyBytes))
         break;
-     nbytes = device->ReadFilter(fd, buffer, sizeof(buffer));
+     nbytes = filter.Read(buffer, sizeof(buffer), 100);
      if (nbytes > 0) {
         anyBytes = true;
         Process(buffer, nbytes);
         }
-     if (hasNIT) {
-        if (ChannelListItems.size() > items) {
-           // new ChannelListItems, remove duplicates.
-           std::sort(ChannelListItems.begin(), ChannelListItems.end());
-           auto first_duplicate = std::unique(ChannelListItems.begin(), ChannelListItems.end());
-           ChannelListItems.erase(first_duplicate, ChannelListItems.end());
-           }
+     if (hasNIT)
         break;
-        }
      }
-  device->CloseFilter(fd);
+  data.cell_frequency_links.Sort();
   Cancel();
   active = false;
+  if (done) done->Signal();
 }
 
 /* std::sort */
@@ -564,14 +1248,6 @@ bool operator<(TCell const& lhs, TCell const& rhs) {
   return lhs.cell_id < rhs.cell_id;
 }
 
-/* std::sort */
-void swap(TCell& a, TCell& b) {
-  TCell c;
-  memcpy(&c, &a, sizeof(TCell));
-  memcpy(&a, &b, sizeof(TCell));
-  memcpy(&b, &c, sizeof(TCell));
-}
-
 /* std::sort */
 bool operator<(TFrequencyListItem const& lhs, TFrequencyListItem const& rhs) {
   return ((lhs.network_id < rhs.network_id) or (lhs.frequency < rhs.frequency));
@@ -585,7 +1261,7 @@ void swap(TFrequencyListItem& a, TFrequencyListItem& b) {
   memcpy(&b, &c, sizeof(TFrequencyListItem));
 }
 
-/* std::sort */
+/* GetLCN() */
 bool TChannelListItem::operator < (const TChannelListItem& rhs) {
   if (channel_list_id != rhs.channel_list_id)
      return channel_list_id < rhs.channel_list_id;
@@ -605,7 +1281,7 @@ bool TChannelListItem::operator < (const TChannelListItem& rhs) {
   return false;
 }
 
-/* std::unique */
+/* AddChannelListItem() */
 bool TChannelListItem::operator == (const TChannelListItem& rhs) {
   return
     ( channel_list_id     == rhs.channel_list_id     ) and
@@ -615,93 +1291,149 @@ bool TChannelListItem::operator == (const TChannelListItem& rhs) {
     ( HD_simulcast        == rhs.HD_simulcast        );
 }
 
+/* ChannelListItems are indexed by TID and SID; duplicates are dropped as they
+ * arrive. Of several items of a service, GetLCN() uses the first by operator<.
+ */
+static void AddChannelListItem(const TChannelListItem& item) {
+  const std::lock_guard<std::mutex> lock(ChannelListMutex);
+  auto range = ChannelListItems.equal_range(ServiceKey(item.transport_stream_id, item.service_id));
+  for(auto it = range.first; it != range.second; ++it)
+     if (it->second == item)
+        return;
+  ChannelListItems.insert(std::make_pair(ServiceKey(item.transport_stream_id, item.service_id), item));
+}
+
 bool GetLCN(TChannel* c) {
   if (c == nullptr)
      return false;
 
-  for(auto& it:ChannelListItems) {
-     if (((it.original_network_id == c->ONID) or (it.network_id == c->NID)) and
-         (it.transport_stream_id == c->TID ) and
-         (it.service_id          == c->SID )) {
-        c->LCN       = it.LCN;
-        c->LCN_minor = it.LCN_minor;
-        return true;
-        }
+  const std::lock_guard<std::mutex> lock(ChannelListMutex);
+  TChannelListItem* first = nullptr;
+
+  auto range = ChannelListItems.equal_range(ServiceKey(c->TID, c->SID));
+  for(auto it = range.first; it != range.second; ++it) {
+     TChannelListItem& item = it->second;
+     if ((item.original_network_id == c->ONID) or (item.network_id == c->NID))
+        if (first == nullptr or item < *first)
+           first = &item;
+     }
+
+  if (first) {
+     c->LCN       = first->LCN;
+     c->LCN_minor = first->LCN_minor;
+     return true;
      }
 
-  dlog(5, "no LCN for " + IntToStr(c->SID) + ":" + IntToStr(c->ONID) + ":" + IntToStr(c->TID)); 
+  if (wSetup.verbosity > 4)
+     dlog(5, "no LCN for " + IntToStr(c->SID) + ":" + IntToStr(c->ONID) + ":" + IntToStr(c->TID));
   return false;
 }
 
 
-void cNitScanner::ParseCellFrequencyLinks(uint16_t network_id, const unsigned char* Data, TList<TCell>& list) {
+/* collects the cells unsorted: cNitScanner::Action() sorts them once, as soon
+ * as the NIT is complete.
+ */
+void cNitScanner::ParseCellFrequencyLinks(uint16_t network_id, const unsigned char* Data) {
   int len = 2 + *(Data + 1);
   int offset = 2;
-  TCell c;
-
-  c.network_id = network_id;
 
   if (wSetup.verbosity > 5)
      hexdump("cNitScanner", Data, len);
 
   while(len >= 7) {
+     TCell c;
+     c.network_id = network_id;
      c.cell_id = Data[offset + 0] << 8 |
                  Data[offset + 1];
      c.frequency = (Data[offset + 2] << 24 |
                     Data[offset + 3] << 16 |
                     Data[offset + 4] << 8  |
                     Data[offset + 5]) * 10;
-     c.subcellcount = Data[offset + 6] / 5;
+     int subcellcount = Data[offset + 6] / 5;
      offset += 7;
      len -= 7;
-     
-     for(int i = 0; i < c.subcellcount; i++) {
-        c.subcells[i].cell_id_extension = Data[offset];
-        c.subcells[i].transposer_frequency = (Data[offset + 1] << 24 |
-                                              Data[offset + 2] << 16 |
-                                              Data[offset + 3] << 8  |
-                                              Data[offset + 4]) * 10;
+
+     c.subcells.resize(subcellcount);
+     for(auto& subcell:c.subcells) {
+        subcell.cell_id_extension = Data[offset];
+        subcell.transposer_frequency = (Data[offset + 1] << 24 |
+                                        Data[offset + 2] << 16 |
+                                        Data[offset + 3] << 8  |
+                                        Data[offset + 4]) * 10;
         offset += 5;
         len -= 5;
         }
-     
-     bool found = false;
-     for(int i = 0; i < list.Count(); i++) {
-        if ((list[i].cell_id == c.cell_id) and
-            (list[i].network_id == c.network_id)) {
-           found = true;
-           break;
-           }
-        }
 
-     if (!found) {
-        list.Add(c);
-        list.Sort();
-        }
+     if (data.cell_ids.insert((uint32_t) c.network_id << 16 | c.cell_id).second)
+        data.cell_frequency_links.Add(c);
      } 
 }
 
+/* source, ie. "S192E", "C0085" or "T2174". Cable and terrestrial networks of
+ * different operators or sites may share a NID, so there the key has the
+ * ONID of the section's first transport stream as well. A section listing
+ * another ONID first ends up in another sub-table, which never completes:
+ * that NIT isn't cached then.
+ */
+std::string cNitScanner::CacheKey(int TableId, int Extension, int ONID) {
+  std::string source;
+  switch(type) {
+     case SCAN_SATELLITE:   source = "S" + IntToStr(orbital) + (west ? "W" : "E"); break;
+     case SCAN_CABLE:       source = "C" + IntToHex(ONID, 4); break;
+     case SCAN_TERRESTRIAL: source = "T" + IntToHex(ONID, 4); break;
+     default:               source = "A";
+     }
+  return cSiCache::Key(source, TableId, Extension);
+}
+
 void cNitScanner::Process(const unsigned char* Data, int Length) {
-  SI::NIT nit(Data, false);
+  if (repeats.Known(Data, Length))
+     return;
 
-  if (!nit.CheckCRCAndParse())
+  TSection<SI::NIT> nit(Data);
+
+  if (!nit.CheckCRCAndParse(Length))
      return;
+  repeats.Add(Data, Length);
 
   if (Data[0] != SI_EXT::TABLE_ID_NIT_ACTUAL and
       Data[0] != SI_EXT::TABLE_ID_NIT_OTHER)
      return;
 
-  int len = nit.getLength();
-  uint32_t crc32 = Data[len-4] << 24 | Data[len-3] << 16 | Data[len-2] << 8 | Data[len-1];
+  if (!nit.getCurrentNextIndicator())
+     return;
 
-  if (first_crc32 == crc32) {
+  int size = 3 + ((Data[1] & 0x0F) << 8 | Data[2]); // without stuffing, if any.
+  int onid = 0;
+  SI::NIT::TransportStream ts;
+  SI::Loop::Iterator it;
+  if (nit.transportStreamLoop.getNext(ts, it))
+     onid = ts.getOriginalNetworkId();
+
+  // the NIT is the same on all transponders of a network: if this version
+  // was seen complete before and this section is the cached one, take it
+  // from the cache.
+  std::string key = CacheKey(Data[0], nit.getTableIdExtension(), onid);
+  std::vector<std::vector<unsigned char>> cached;
+  if (SiCache.Get(key, nit.getVersionNumber(), nit.getSectionNumber(), nit.getLastSectionNumber(), Data, size, cached)) {
+     dlog(4, "NIT " + key + " version " + IntToStr(nit.getVersionNumber()) + " from cache");
+     for(auto& c:cached) {
+        TSection<SI::NIT> section(c.data());
+        if (section.CheckCRCAndParse(c.size()))
+           Parse(section, c.data(), c.size());
+        }
      hasNIT = true;
      return;
      }
 
-  if (!first_crc32)
-     first_crc32 = crc32;
+  if (!sections.Add(Data[0], nit.getTableIdExtension(), nit.getVersionNumber(), nit.getSectionNumber(), nit.getLastSectionNumber()))
+     return;
+  SiCache.Add(key, nit.getVersionNumber(), nit.getSectionNumber(), nit.getLastSectionNumber(), Data, size);
+  hasNIT = sections.Complete();
+  Parse(nit, Data, Length);
+}
 
+void cNitScanner::Parse(SI::NIT& nit, const unsigned char* Data, int Length) {
   if (wSetup.verbosity > 5)
      hexdump(__PRETTY_FUNCTION__, Data, Length);
 
@@ -759,7 +1491,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
         int len = *(Data + offset + 1);
         switch(*(Data + offset)) {
            case SI::CellFrequencyLinkDescriptorTag: { // cell_frequency_link_descriptor, DVB-T/T2 only.
-              ParseCellFrequencyLinks(nit.getNetworkId(), Data + offset, data.cell_frequency_links);
+              ParseCellFrequencyLinks(nit.getNetworkId(), Data + offset);
               offset += 2 + *(Data + offset + 1);
               break;
               }
@@ -823,7 +1555,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                  }
               uint32_t SymbolRate = round(BCDtoDecimal(sd->getSymbolRate()) / 10.0);
 
-              TChannel* transponder = new TChannel;
+              TChannel* transponder = ScanChannels.New();
               transponder->NID = nit.getNetworkId();
               transponder->ONID = ts.getOriginalNetworkId();
               transponder->TID = ts.getTransportStreamId();
@@ -840,18 +1572,12 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
               if (!sd->getWestEastFlag())
                  transponder->OrbitalPos *= -1;
 
-              bool found = false;
-              for(int i = 0; !found and i < data.transport_streams.Count(); i++) {
-                 std::string t;
-                 transponder->PrintTransponder(t);
-                 TChannel* ts = data.transport_streams[i];
-                 ts->PrintTransponder(s);
-                 if (s == t and ts->TID == transponder->TID and
-                    (ts->NID == transponder->NID or ts->ONID == transponder->ONID))
-                    found = true;
-                 }
-              if (!found)
+              if (!data.transport_stream_set.Contains(transponder)) {
                  data.transport_streams.Add(transponder);
+                 data.transport_stream_set.Add(transponder);
+                 }
+              else
+                 ScanChannels.Free(transponder);
               } // end SI::SatelliteDeliverySystemDescriptorTag
               break;
 
@@ -904,7 +1630,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                  case 5 : Modulation = 256; break;
                  default: Modulation = 999;
                  }
-              TChannel* transponder = new TChannel;
+              TChannel* transponder = ScanChannels.New();
               uint32_t SymbolRate = round(BCDtoDecimal(sd->getSymbolRate()) / 10.0);
               transponder->NID = nit.getNetworkId();
               transponder->ONID = ts.getOriginalNetworkId();
@@ -916,18 +1642,12 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
               transponder->FEC = CodeRate;
               transponder->Modulation = Modulation;
 
-              bool found = false;
-              for(int i = 0; !found and i < data.transport_streams.Count(); i++) {
-                 std::string t;
-                 transponder->PrintTransponder(t);
-                 TChannel* ts = data.transport_streams[i];
-                 ts->PrintTransponder(s);
-                 if (s == t and ts->TID == transponder->TID and
-                    (ts->NID == transponder->NID or ts->ONID == transponder->ONID))
-                    found = true;
-                 }
-              if (!found)
+              if (!data.transport_stream_set.Contains(transponder)) {
                  data.transport_streams.Add(transponder);
+                 data.transport_stream_set.Add(transponder);
+                 }
+              else
+                 ScanChannels.Free(transponder);
               } // end SI::CableDeliverySystemDescriptorTag
               break;
 
@@ -991,7 +1711,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                  default:;
                  }
 
-              TChannel* transponder = new TChannel;
+              TChannel* transponder = ScanChannels.New();
               transponder->NID = nit.getNetworkId();
               transponder->ONID = ts.getOriginalNetworkId();
               transponder->TID = ts.getTransportStreamId();
@@ -1008,18 +1728,12 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
               transponder->Guard = GuardInterval;
               transponder->Hierarchy = Hierarchy;
 
-              bool found = false;
-              for(int i = 0; !found and i < data.transport_streams.Count(); i++) {
-                 std::string t;
-                 transponder->PrintTransponder(t);
-                 TChannel* ts = data.transport_streams[i];
-                 ts->PrintTransponder(s);
-                 if (s == t and ts->TID == transponder->TID and
-                    (ts->NID == transponder->NID or ts->ONID == transponder->ONID))
-                    found = true;
-                 }
-              if (!found)
+              if (!data.transport_stream_set.Contains(transponder)) {
                  data.transport_streams.Add(transponder);
+                 data.transport_stream_set.Add(transponder);
+                 }
+              else
+                 ScanChannels.Free(transponder);
               } // end SI::TerrestrialDeliverySystemDescriptorTag
               break;
            case SI::ExtensionDescriptorTag: {
@@ -1030,7 +1744,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                        continue;
 
                     SI::T2DeliverySystemDescriptor* td = (SI::T2DeliverySystemDescriptor*) d;
-                    TChannel* transponder = new TChannel;
+                    TChannel* transponder = ScanChannels.New();
                     transponder->NID        = nit.getNetworkId();
                     transponder->ONID       = ts.getOriginalNetworkId();
                     transponder->TID        = ts.getTransportStreamId();
@@ -1139,19 +1853,12 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                        transponder->Frequency = transponder->cells[0].center_frequencies[0];
 
 
-                    bool found = false;
-                    for(int i = 0; !found and i < data.transport_streams.Count(); i++) {
-                       std::string t;
-                       transponder->PrintTransponder(t);
-                       TChannel* ts = data.transport_streams[i];
-                       ts->PrintTransponder(s);
-                       if (s == t and ts->TID == transponder->TID and
-                          (ts->NID == transponder->NID or ts->ONID == transponder->ONID) and
-                           ts->cells.Count() == transponder->cells.Count())
-                          found = true;
-                       }
-                    if (!found)
+                    if (!data.transport_stream_set.Contains(transponder, true)) {
                        data.transport_streams.Add(transponder);
+                       data.transport_stream_set.Add(transponder);
+                       }
+                    else
+                       ScanChannels.Free(transponder);
                     } // SI::T2DeliverySystemDescriptorTag
                     break; // end T2 delsys
                  default:;
@@ -1186,7 +1893,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
               if (type != SCAN_TERRESTRIAL)
                  continue;
 
-              ParseCellFrequencyLinks(nit.getNetworkId(), d->getData().getData(), data.cell_frequency_links);
+              ParseCellFrequencyLinks(nit.getNetworkId(), d->getData().getData());
               break; // not implemented in libsi
            case SI::CellListDescriptorTag:
               if (type != SCAN_TERRESTRIAL)
@@ -1239,7 +1946,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                                 item.HD_simulcast        = false;
                                 item.LCN                 = LogicalChannel.LCN();
                                 item.LCN_minor           = -1; /* invalid */
-                                ChannelListItems.push_back(item);
+                                AddChannelListItem(item);
 
                                 dlog(6, "logical channel"
                                       ", ONID:" + IntToStr(item.original_network_id) +
@@ -1310,7 +2017,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                                          ", SID:"  + IntToStr(item.service_id) +
                                          ", LID:"  + IntToStr(item.channel_list_id) +
                                          ", LCN:"  + IntToStr(item.LCN));
-                                   ChannelListItems.push_back(item);
+                                   AddChannelListItem(item);
                                    }
                                 } // LCN loop
                              } // byte loop
@@ -1351,7 +2058,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                                 item.HD_simulcast        = HD_simulcast;
                                 item.LCN                 = LogicalChannel.LCN();
                                 item.LCN_minor           = -1; /* invalid */
-                                ChannelListItems.push_back(item);
+                                AddChannelListItem(item);
 
                                 dlog(6, "logical channel"
                                       ", ONID:" + IntToStr(item.original_network_id) +
@@ -1389,7 +2096,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                                 item.HD_simulcast        = false;
                                 item.LCN                 = LogicalChannel.LCN();
                                 item.LCN_minor           = -1; /* invalid */
-                                ChannelListItems.push_back(item);
+                                AddChannelListItem(item);
                                 dlog(6, "logical channel"
                                       ", ONID:" + IntToStr(item.original_network_id) +
                                       ", TSID:" + IntToStr(item.transport_stream_id) +
@@ -1459,7 +2166,7 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
                                          ", SID:"  + IntToStr(item.service_id) +
                                          ", LID:"  + IntToStr(item.channel_list_id) +
                                          ", LCN:"  + IntToStr(item.LCN));
-                                   ChannelListItems.push_back(item);
+                                   AddChannelListItem(item);
                                    }
                                 } // LCN loop
                              } // byte loop
@@ -1481,10 +2188,6 @@ void cNitScanner::Process(const unsigned char* Data, int Length) {
         DeleteNullptr(d);
         } // end TS descriptor loop
      } // end TS stream loop
-
-  // we have all parts of nit seen.
-  if (nit.getSectionNumber() == nit.getLastSectionNumber())
-     active = false;
 }
 
 
@@ -1498,8 +2201,7 @@ TChannel* GetByTransponder(const TChannel* Transponder) {
      maxdelta = 250;  // kHz -> France (UK: no longer)
 
   if (NewChannels.Count()) {
-     for(int idx = 0; idx < NewChannels.Count(); ++idx) {
-        TChannel* ch = NewChannels[idx];
+     for(auto ch:NewChannels.Lock()) {
         if (is_nearly_same_frequency(ch, Transponder, maxdelta) &&
             ch->Source == Transponder->Source &&
             ch->TID == Transponder->TID &&
@@ -1516,69 +2218,75 @@ TChannel* GetByTransponder(const TChannel* Transponder) {
 /*******************************************************************************
  * cSdtScanner
  ******************************************************************************/
-cSdtScanner::cSdtScanner(cDevice * Parent, TSdtData& Data) : 
-  active(true), device(Parent), data(Data), hasSDT(false),
-  anyBytes(false)
+cSdtScanner::cSdtScanner(cDevice * Parent, TSdtData& Data, cScanReceiver* Receiver, cScanEvent* Event, bool Other) : 
+  active(true), device(Parent), receiver(Receiver), data(Data), event(Event), hasSDT(false),
+  anyBytes(false), other(Other), anyOther(false), otherCycled(false), otherDone(false)
 {
   data.original_network_id = 0;
-  first_crc32 = 0;
   Start();
 }
 
 cSdtScanner::~cSdtScanner() {
   active = false;
-  wait.Signal();
 }
 
 void cSdtScanner::Action(void) {
-  int count = 0;
+  cScanEvent* done = event;
+  auto start = std::chrono::steady_clock::now();
   int nbytes = 0;
   unsigned char buffer[4096];
 
-  int fd = device->OpenFilter(SI_EXT::PID_SDT, SI_EXT::TABLE_ID_SDT_ACTUAL, 0xFF);
+  // mask 0xFB: both 0x42 (actual) and 0x46 (other)
+  cSectionFilter filter(device, receiver, SI_EXT::PID_SDT, SI_EXT::TABLE_ID_SDT_ACTUAL, other ? 0xFB : 0xFF);
   while(Running() && active) {
-     if (wait.Wait(10)) {
-        dlog(5, "cSdtScanner: received signal");
-        break;
-        }
-     if (count++ > 4000) { //40sec
+     int ms = Elapsed(start);
+     if (ms > 40000) {
         dlog(2, "SDT timeout");
         break;
         }
-     else if ((count > 1800) and not(anyBytes))
+     else if ((ms > 18000) and not(anyBytes))
         break;
-     nbytes = device->ReadFilter(fd, buffer, sizeof(buffer));
+     nbytes = filter.Read(buffer, sizeof(buffer), 100);
      if (nbytes > 0) {
         anyBytes = true;
         Process(buffer, nbytes);
         }
-     if (hasSDT)
+     // SDT other is repeated at least every 10sec: wait for it, until all of its
+     // sections were seen and it started to repeat, or until that window passed.
+     if (hasSDT and (!other or otherDone or ms > 10000))
         break;
      }
 
-  device->CloseFilter(fd);
-  fd = -1;
   active = false;
+  if (done) done->Signal();
 }
 
 void cSdtScanner::Process(const unsigned char* Data, int Length) {
-
-  SI::SDT sdt(Data, false);
-  if (!sdt.CheckCRCAndParse())
+  if (repeats.Known(Data, Length)) {
+     if (Data[0] == SI_EXT::TABLE_ID_SDT_OTHER) {
+        otherCycled = true;
+        otherDone = sections.Complete(SI_EXT::TABLE_ID_SDT_OTHER);
+        }
      return;
+     }
 
-  int len = sdt.getLength();
-  uint32_t crc32 = Data[len-4] << 24 | Data[len-3] << 16 | Data[len-2] << 8 | Data[len-1];
-
-  if (first_crc32 == crc32) {
-     hasSDT = true;
+  TSection<SI::SDT> sdt(Data);
+  if (!sdt.CheckCRCAndParse(Length))
      return;
-     }
+  repeats.Add(Data, Length);
 
-  if (!first_crc32)
-     first_crc32 = crc32;
+  if (!sdt.getCurrentNextIndicator() or
+      !sections.Add(Data[0], sdt.getTableIdExtension(), sdt.getVersionNumber(), sdt.getSectionNumber(), sdt.getLastSectionNumber()))
+     return;
+  hasSDT = sections.Complete(SI_EXT::TABLE_ID_SDT_ACTUAL);
 
-  if (data.original_network_id == 0)
+  if (Data[0] == SI_EXT::TABLE_ID_SDT_OTHER) {
+     anyOther = true;
+     if (sections.Complete(Data[0], sdt.getTableIdExtension()))
+        data.complete_other.insert(sdt.getOriginalNetworkId() << 16 | sdt.getTransportStreamId());
+     otherDone = otherCycled and sections.Complete(SI_EXT::TABLE_ID_SDT_OTHER);
+     }
+  else if (data.original_network_id == 0)
      data.original_network_id = sdt.getOriginalNetworkId();
 
   if (wSetup.verbosity > 5)
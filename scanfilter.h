@@ -6,10 +6,20 @@
 #include <string>
 #include <cstdint>        // uint{8.16,32}_t
 #include <atomic>         // std::atomic<bool>
-#include <vdr/thread.h>   // cCondWait
+#include <vector>         // std::vector<>
+#include <deque>          // std::deque<>
+#include <map>            // std::map<>
+#include <unordered_map>  // std::unordered_multimap<>
+#include <unordered_set>  // std::unordered_set<>
+#include <bitset>         // std::bitset<>
+#include <mutex>          // std::mutex
+#include <functional>     // std::function<>
+#include <condition_variable>
 #include <vdr/sections.h> // cSectionSyncer
+#include <vdr/receiver.h> // cReceiver
 #include "tlist.h"        // TList<T>
 #include "common.h"       // TPid
+#include "pmtpool.h"      // cPmtJob, cPmtPool
 
 
 /*******************************************************************************
@@ -17,12 +27,19 @@
  ******************************************************************************/
 class cDevice;
 class TChannel;
+namespace SI { class NIT; }
 extern int nextTransponders;
+extern TArena<TChannel> ScanChannels;
 
 bool known_transponder(TChannel* newChannel, bool auto_allowed, TChannels* list = nullptr);
 bool is_nearly_same_frequency(const TChannel* chan_a, const TChannel* chan_b, unsigned delta = 2001);
 bool is_different_transponder_deep_scan(const TChannel* a, const TChannel* b, bool auto_allowed);
 TChannel* GetByTransponder(const TChannel* Transponder);
+void AddNewTransponder(TChannel* Transponder, int Owner);
+void AddScannedTransponder(TChannel* Transponder);
+// call after the tuning parameters of a transponder in NewTransponders or ScannedTransponders changed.
+void TransponderChanged(TChannel* Transponder);
+TChannel* NextTransponder(int Owner);
 void resetLists(void);
 
 
@@ -64,15 +81,16 @@ struct TPmtData {
   TList<int> Caids;
 };
 
+struct TSubcell {
+  uint8_t cell_id_extension;
+  uint32_t transposer_frequency;
+};
+
 struct TCell {
   uint16_t network_id;
   uint16_t cell_id;
   uint32_t frequency;
-  uint8_t subcellcount;
-  struct {
-     uint8_t cell_id_extension;
-     uint32_t transposer_frequency;
-     } subcells[51];
+  std::vector<TSubcell> subcells;   // up to 51
 };
 
 struct TServiceListItem {
@@ -104,13 +122,32 @@ struct TChannelListItem {
 // returns true, if GetLCN() assigned a new LCN to 'c'.
 bool GetLCN(TChannel* c);
 
+/*******************************************************************************
+ * class TTransportStreamSet, the transport streams of a TNitData by TID and
+ * tuning parameters. Contains() is true for a transport stream with the same
+ * PrintTransponder() line, the same TID and the same NID or ONID as one of the
+ * set, without formatting any of them.
+ ******************************************************************************/
+class TTransportStreamSet {
+private:
+  std::unordered_multimap<uint64_t, TChannel*> items;
+  static uint64_t Hash(const TChannel* t);
+  static bool Same(const TChannel* a, const TChannel* b);
+public:
+  bool Contains(TChannel* t, bool SameCells = false) const;  // SameCells: DVB-T2 cells count too.
+  void Add(TChannel* t);
+  void Clear(void) { items.clear(); }
+};
+
 struct TNitData {
   int OrbitalPos;
   bool West;
   TList<TFrequencyListItem> frequency_list;
-  TList<TCell> cell_frequency_links;
+  TList<TCell> cell_frequency_links;        // sorted by cell_id, once the NIT is complete.
+  std::unordered_set<uint32_t> cell_ids;     // cell_frequency_links, by network_id and cell_id.
   TList<TServiceListItem> service_types;
   TList<TChannel*> transport_streams;
+  TTransportStreamSet transport_stream_set;  // transport_streams, for duplicate checks.
 };
 
 struct sdtservice {
@@ -128,6 +165,130 @@ struct sdtservice {
 struct TSdtData {
   uint16_t original_network_id;
   TList<sdtservice> services;
+  std::unordered_set<uint32_t> complete_other; // ONID << 16 | TID, if all sections of its SDT other were seen
+};
+
+// moves the NIT/SDT results of one transponder to NitData and SdtData.
+void MergeTables(TNitData& Nit, TSdtData& Sdt);
+// deletes the NIT/SDT results of one transponder.
+void ClearTables(TNitData& Nit, TSdtData& Sdt);
+// index of the first service in SdtData with this TID and SID, -1 if none.
+int FindSdtService(int TID, int SID);
+// a channel of NewChannels without SDT service; named as soon as MergeTables() adds it.
+void AddUnnamedChannel(TChannel* Channel);
+
+
+/*******************************************************************************
+ * class cScanReceiver
+ * software section demultiplexer: receives the TS packets of all subscribed
+ * PIDs and reassembles their sections. One receiver serves all scanners of a
+ * transponder, instead of one hardware section filter per table.
+ ******************************************************************************/
+typedef std::function<void(const unsigned char* Data, int Length)> TSectionHandler;
+
+class cScanReceiver : public cReceiver {
+private:
+  struct TPidState {
+     int cc;                              // last continuity counter, -1 if unknown
+     bool reserved;                       // kept without subscriptions, see Reserve()
+     std::vector<unsigned char> section;  // incomplete section
+  };
+  struct TSubscription {
+     int Pid;
+     int Tid;
+     int Mask;
+     TSectionHandler Handler;
+  };
+  cDevice* device;
+  std::mutex mutex;                       // pids, subscriptions
+  std::mutex applyMutex;
+  std::map<int,TPidState> pids;
+  std::map<int,TSubscription> subscriptions;
+  std::vector<int> applied;               // pids, as given to the device
+  int nextHandle;
+  int Append(TPidState& State, int Pid, const unsigned char* Data, int Length);
+  void Dispatch(int Pid, const unsigned char* Data, int Length);
+protected:
+  virtual void Receive(const uchar* Data, int Length);
+public:
+  // Pids are set before the first AttachReceiver() and stay, as Reserve().
+  cScanReceiver(cDevice* Device, const std::vector<int>& Pids = std::vector<int>());
+  virtual ~cScanReceiver();
+  // Handler is called from the device's receive thread, with the receiver locked.
+  // Returns a handle for Unsubscribe(), or -1 if there is no free PID.
+  int  Subscribe(int Pid, int Tid, int Mask, TSectionHandler Handler);
+  void Unsubscribe(int Handle);
+  // adds Pids in one go, as long as there are free PIDs, and re-attaches the receiver
+  // once; they stay, if unsubscribed. Returns the number of PIDs added.
+  int  Reserve(const std::vector<int>& Pids);
+  // re-attaches the receiver, if PIDs were added since the last Apply().
+  bool Apply(void);
+  int  FreePids(void);
+};
+
+
+/*******************************************************************************
+ * class cSectionFilter
+ * sections of one PID and table id, either from a cScanReceiver or from a
+ * hardware section filter, if there is no receiver or it has no free PID.
+ ******************************************************************************/
+class cSectionFilter {
+private:
+  cDevice* device;
+  cScanReceiver* receiver;
+  int fd;
+  int handle;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::vector<unsigned char>> sections;
+public:
+  cSectionFilter(cDevice* Device, cScanReceiver* Receiver, int Pid, int Tid, int Mask = 0xFF);
+  ~cSectionFilter();
+  // returns the length of the section copied to Buffer, 0 on timeout.
+  int Read(unsigned char* Buffer, int Size, int TimeoutMs);
+};
+
+
+/*******************************************************************************
+ * class cSectionBitmap
+ * which sections of each sub-table (table_id, table_id_extension) were seen.
+ * A sub-table is complete as soon as all its sections arrived, instead of
+ * waiting for the first section to repeat. A new version restarts it.
+ ******************************************************************************/
+class cSectionBitmap {
+private:
+  struct TSubTable {
+     int version;
+     int last;
+     std::bitset<256> seen;
+  };
+  std::map<uint32_t,TSubTable> tables; // table_id << 16 | table_id_extension
+public:
+  // returns false, if this section was seen before.
+  bool Add(int TableId, int Extension, int Version, int Section, int LastSection);
+  // true, if all sub-tables seen so far are complete.
+  bool Complete(void);
+  // same, for one table_id only.
+  bool Complete(int TableId);
+  // same, for one sub-table only.
+  bool Complete(int TableId, int Extension);
+};
+
+
+/*******************************************************************************
+ * class cSectionRepeats
+ * recognizes a section, which was handled before, by its header and CRC: its
+ * repetitions are dropped before the CRC is computed and the section is parsed again.
+ ******************************************************************************/
+class cSectionRepeats {
+private:
+  std::unordered_map<uint64_t,uint32_t> crcs; // table_id, table_id_extension, version, section_number
+  static bool Key(const unsigned char* Data, int Length, uint64_t& Key, uint32_t& Crc);
+public:
+  // true, if this section was Add()ed before, with the same CRC.
+  bool Known(const unsigned char* Data, int Length);
+  // call after the section passed its CRC check and was handled.
+  void Add(const unsigned char* Data, int Length);
 };
 
 
@@ -137,11 +298,13 @@ struct TSdtData {
 class cPatScanner : public ThreadBase {
 private:
   cDevice* device;
+  cScanReceiver* receiver;
   struct TPatData& PatData;
   std::atomic<bool> isActive;
   cSectionSyncer Sync;
+  cSectionRepeats repeats;
   std::string s;
-  cCondWait wait;
+  cScanEvent* event;
   TChannel channel;
   std::atomic<bool> hasPAT;
   bool anyBytes;
@@ -149,32 +312,35 @@ protected:
   virtual void Process(const unsigned char* Data, int Length);
   virtual void Action(void);
 public:
-  cPatScanner(cDevice* Parent, struct TPatData& Dest);
+  cPatScanner(cDevice* Parent, struct TPatData& Dest, cScanReceiver* Receiver = nullptr, cScanEvent* Event = nullptr);
   ~cPatScanner();
   bool HasPAT(void) { return hasPAT; };
   bool Active(void) { return isActive; };
+  void Stop(void) { isActive = false; };
 };
 
 
 /*******************************************************************************
  * class cPmtScanner
+ * one PMT job, run by a cPmtPool worker.
  ******************************************************************************/
-class cPmtScanner : public ThreadBase {
+class cPmtScanner : public cPmtJob {
 private:
   cDevice* device;
+  cScanReceiver* receiver;
   TPmtData* data;
   std::atomic<bool> isActive;
   std::atomic<bool> jobDone;
   std::string s;
-  cCondWait wait;
 protected:
   virtual void Process(const unsigned char* Data, int Length);
-  virtual void Action(void);
 public:
-  cPmtScanner(cDevice* Parent, TPmtData* Data);
-  ~cPmtScanner();
+  cPmtScanner(cDevice* Parent, TPmtData* Data, cScanReceiver* Receiver = nullptr);
+  virtual ~cPmtScanner();
+  virtual void Scan(unsigned char* Buffer, int Size);
   bool Active(void) { return isActive; };
   bool Finished(void) { return jobDone; };
+  void Stop(void) { isActive = false; };
 };
 
 
@@ -185,25 +351,30 @@ class cNitScanner : public ThreadBase {
 private:
   std::atomic<bool> active;
   cDevice* device;
+  cScanReceiver* receiver;
   uint16_t nit;
   std::string s;
-  cCondWait wait;
+  cScanEvent* event;
   TNitData& data;
-  uint32_t first_crc32;
+  cSectionBitmap sections;
+  cSectionRepeats repeats;
   int type;
   std::atomic<bool> hasNIT;
   bool west;
   uint16_t orbital;
   bool anyBytes;
-  void ParseCellFrequencyLinks(uint16_t network_id, const unsigned char* Data, TList<TCell>& list);
+  void ParseCellFrequencyLinks(uint16_t network_id, const unsigned char* Data);
+  std::string CacheKey(int TableId, int Extension, int ONID);
+  void Parse(SI::NIT& Nit, const unsigned char* Data, int Length); // Nit: CRC checked and parsed
 protected:
   virtual void Process(const unsigned char* Data, int Length);
   virtual void Action(void);
 public:
-  cNitScanner(cDevice* Parent, uint16_t network_PID, TNitData& Data, int Type);
+  cNitScanner(cDevice* Parent, uint16_t network_PID, TNitData& Data, int Type, cScanReceiver* Receiver = nullptr, cScanEvent* Event = nullptr);
   ~cNitScanner();
   bool Active(void) { return (active); };
   bool HasNIT(void) { return hasNIT; };
+  void Stop(void) { active = false; };
 };
 
 
@@ -214,18 +385,26 @@ class cSdtScanner : public ThreadBase {
 private:
   std::atomic<bool> active;
   cDevice* device;
+  cScanReceiver* receiver;
   TSdtData& data;
   std::string s;
-  cCondWait wait;
-  uint32_t first_crc32;
+  cScanEvent* event;
+  cSectionBitmap sections;
+  cSectionRepeats repeats;
   std::atomic<bool> hasSDT;
   bool anyBytes;
+  bool other;
+  bool anyOther;
+  bool otherCycled;
+  bool otherDone;
 protected:
   virtual void Process(const unsigned char* Data, int Length);
   virtual void Action(void);
 public:
-  cSdtScanner(cDevice* Parent, TSdtData& Data);
+  // Other: collect SDT other as well, ie. the services of all transport streams of this network.
+  cSdtScanner(cDevice* Parent, TSdtData& Data, cScanReceiver* Receiver = nullptr, cScanEvent* Event = nullptr, bool Other = false);
   ~cSdtScanner();
   bool Active(void) { return active; };
   bool SdtNIT(void) { return hasSDT; };
+  void Stop(void) { active = false; };
 };
@@ -5,8 +5,16 @@
 #include <string>
 #include <array>
 #include <algorithm>     // std::min()
+#include <set>
+#include <map>
+#include <tuple>
+#include <functional>  // std::function
+#include <unordered_map>
+#include <unordered_set>
+#include <linux/dvb/frontend.h> // FE_HAS_SIGNAL, FE_HAS_CARRIER, FE_HAS_LOCK
 #include <vdr/sources.h>
 #include <vdr/device.h>
+#include <vdr/channels.h>
 #include "scanner.h"
 #include "menusetup.h"
 #include "common.h"
@@ -15,6 +23,8 @@
 #include "statemachine.h"
 #include "countries.h"
 #include "wirbelscan_services.h"
+#include "lockprofiles.h"
+#include "sicache.h"
 #if VDRVERSNUM < 20301
    #error "Your VDR version is too old - STOP."
 #endif
@@ -147,6 +157,79 @@ cDevice* GetPreferredDevice(TChannel* Channel) {
 
 
 
+/*******************************************************************************
+ * class cScanJob
+ ******************************************************************************/
+
+cScanJob::cScanJob(cDevice* Dev, TChannel* Transponder, bool UseNit, void* Parent, cScanEvent* Idle, bool Discovered) :
+  dev(Dev), transponder(Discovered ? Transponder : new TChannel), useNit(UseNit), parent(Parent),
+  discovered(Discovered), stop(false), idle(Idle)
+{
+  if (!discovered) {
+     transponder->CopyTransponderData(Transponder);
+     transponder->Name       = Transponder->Name;
+     transponder->NID        = Transponder->NID;
+     transponder->ONID       = Transponder->ONID;
+     transponder->TID        = Transponder->TID;
+     transponder->SID        = Transponder->SID;
+     transponder->OrbitalPos = Transponder->OrbitalPos;
+     transponder->West       = Transponder->West;
+     transponder->Tested     = false;
+     }
+  Start();
+}
+
+cScanJob::~cScanJob(void) {
+  if (!discovered)
+     DeleteNullptr(transponder);
+}
+
+void cScanJob::Action(void) {
+  cScanEvent* finished = idle;
+  cChannel c;
+  bool lock = true;
+
+  if (!discovered) {
+     // skip ChannelID check in cChannel::Parse()
+     // we just want to tune here, nothing else.
+     int nid = transponder->NID;
+     int sid = transponder->SID;
+     transponder->NID = 0x2000;
+     transponder->SID = 0x2000;
+     transponder->VdrChannel(c);
+     transponder->NID = nid;
+     transponder->SID = sid;
+     uint32_t before = GetFrontendFrequency(dev);
+     dev->SwitchChannel(&c, false);
+
+     if (MenuScanning)
+        MenuScanning->SetStr(0, false);
+
+     lock = WaitForLock(dev, transponder, before);
+     }
+
+  if (lock and not stop) {
+     if (!discovered) {
+        lStrength = std::min((size_t)dev->SignalStrength(), (size_t)100);
+        if (MenuScanning)
+           MenuScanning->SetStr(lStrength, lock);
+        }
+     cStateMachine* StateMachine = new cStateMachine(dev, transponder, useNit, parent, &done);
+     while(StateMachine->Active()) {
+        if (stop)
+           StateMachine->DoStop();
+        done.Wait(100);
+        }
+     DeleteNullptr(StateMachine);
+     }
+
+  dev->DetachAllReceivers();
+  finished->Signal();
+  Cancel();
+}
+
+
+
 /*******************************************************************************
  * class cScanner
  ******************************************************************************/
@@ -154,7 +237,7 @@ cDevice* GetPreferredDevice(TChannel* Channel) {
 cScanner::cScanner(const char* Description, int Type) :
   shouldstop(false), single(false),
   status(0), initialTransponders(0), newTransponders(0), thisChannel(-1),
-  type(Type), dev(nullptr), aChannel(nullptr), StateMachine(nullptr)
+  type(Type), dev(nullptr), aChannel(nullptr)
 {
   user[0] = user[1] = user[2] = 0; 
   Start();
@@ -167,8 +250,12 @@ cScanner::~cScanner(void) {
 
 void cScanner::SetShouldstop(bool On) {
   shouldstop = On;
-  if (StateMachine)
-     StateMachine->DoStop();
+  if (On) {
+     const std::lock_guard<std::mutex> lock(jobMutex);
+     for(auto job:jobs)
+        if (job) job->DoStop();
+     idle.Signal();
+     }
 }
 
 bool cScanner::ActionAllowed(void) {
@@ -201,19 +288,219 @@ cDvbDevice* cScanner::DvbDevice(void) {
   return GetDvbDevice(dev);
 }
 
+/* with wSetup.ParallelScan, use all other devices of the same type as 'dev',
+ * which are able to tune 'aChannel'. Same device names means same caps,
+ * so the capabilities queried from 'dev' are valid for all of them.
+ */
+void cScanner::AddParallelDevices(void) {
+  devices.clear();
+  devices.push_back(dev);
+
+  if (wSetup.ParallelScan and not single) {
+     int nid = aChannel->NID;
+     int sid = aChannel->SID;
+     aChannel->NID = 0x2000;
+     aChannel->SID = 0x2000;
+     cChannel c;
+     aChannel->VdrChannel(c);
+     aChannel->NID = nid;
+     aChannel->SID = sid;
+
+     for(int i=0; i<cDevice::NumDevices(); i++) {
+        cDevice* d = cDevice::GetDevice(i);
+        if (d == nullptr or d == dev or DeviceName(d) != DeviceName(dev))
+           continue;
+        if (!d->ProvidesTransponder(&c))
+           continue;
+        dlog(3, "frontend " + DeviceName(d) + " (device " + IntToStr(d->CardIndex()) + ")");
+        devices.push_back(d);
+        }
+     }
+
+  const std::lock_guard<std::mutex> lock(jobMutex);
+  jobs.assign(devices.size(), nullptr);
+  if (devices.size() > 1)
+     dlog(3, "scanning with " + IntToStr(devices.size()) + " devices in parallel");
+}
+
+/* first pass of a scan, if wSetup.PreSweep: if the plan tries several parameter
+ * sets on one frequency (symbolrates, modulations, plps, T/T2), tune each of
+ * those frequencies once with its first parameter set. Frequencies, which are
+ * empty for sure, are removed from the plan, so the expensive permutations and
+ * table scans only run where something is on air.
+ * With wSetup.ParallelScan, each device sweeps another frequency at the same time.
+ * A device's frontend status is trusted only after it actually retuned; then it
+ * may take up to SignalWaitTime (or the learned lock time) to show a carrier.
+ * Many DVB-C demods report FE_HAS_CARRIER only with the right symbolrate, so
+ * a frequency is kept also if the probe is ambiguous: the device's frequency
+ * didn't change or it reports a signal strength above noise.
+ */
+void cScanner::PreSweep(std::function<void(const TScanPlanItem&)> SetChannel) {
+  const int NoiseStrength = 10;     // %, below that without carrier: empty frequency.
+  std::map<std::pair<int,char>, int> count;
+  for(auto& item:plan)
+     count[std::make_pair(item.Frequency, item.Polarization)]++;
+
+  if (!wSetup.PreSweep or single or GetDvbDevice(dev) == nullptr or count.size() == plan.size())
+     return;
+
+  std::vector<const TScanPlanItem*> sweep;
+  std::set<std::pair<int,char>> queued;
+  for(auto& item:plan) {
+     auto key = std::make_pair(item.Frequency, item.Polarization);
+     if (count[key] > 1 and queued.insert(key).second)
+        sweep.push_back(&item); // first parameter set of each frequency
+     }
+
+  struct TProbe {
+     cDevice* device;
+     std::pair<int,char> key;
+     uint32_t before;    // frontend frequency before SwitchChannel()
+     int timeout;
+     bool retuned;
+     bool confirmed;     // retuned, as the frontend frequency changed
+     bool done;
+  };
+
+  dlog(4, "pre-sweep of " + IntToStr(count.size()) + " frequencies");
+  std::set<std::pair<int,char>> active;
+  for(size_t next = 0; next < sweep.size(); ) {
+     if (!ActionAllowed())
+        return;
+
+     std::vector<TProbe> probes;
+     for(auto d:devices) {
+        if (next >= sweep.size() or GetDvbDevice(d) == nullptr)
+           continue;
+        const TScanPlanItem& item = *sweep[next++];
+        SetChannel(item);
+        cChannel c;
+        aChannel->NID = 0x2000;
+        aChannel->SID = 0x2000;
+        aChannel->VdrChannel(c);
+        aChannel->NID = 0;
+        aChannel->SID = 0;
+
+        TProbe probe;
+        probe.device  = d;
+        probe.key     = std::make_pair(item.Frequency, item.Polarization);
+        probe.before  = GetFrontendFrequency(d);
+        probe.timeout = std::max(LockProfiles.Timeout(d, aChannel), wSetup.SignalWaitTime * 1000);
+        probe.retuned = false;
+        probe.confirmed = false;
+        probe.done    = false;
+        d->SwitchChannel(&c, false);
+        probes.push_back(probe);
+        }
+
+     for(int t = 0, pending = probes.size(); pending; t += 20) {
+        for(auto& probe:probes) {
+           if (probe.done)
+              continue;
+           if (t >= probe.timeout) {
+              int strength = probe.device->SignalStrength();
+              if (probe.confirmed and strength >= 0 and strength < NoiseStrength)
+                 count[probe.key] = -1;
+              else
+                 dlog(4, IntToStr(probe.key.first) + ": no carrier, but kept (strength " + IntToStr(strength) + "%)");
+              probe.done = true;
+              pending--;
+              continue;
+              }
+           // a polarization change only keeps the frequency: then wait a while instead.
+           if (!probe.retuned) {
+              probe.confirmed = GetFrontendFrequency(probe.device) != probe.before;
+              probe.retuned = probe.confirmed or t >= probe.timeout / 4;
+              }
+           if (probe.retuned and (GetFrontendStatus(probe.device) & (FE_HAS_SIGNAL | FE_HAS_CARRIER | FE_HAS_LOCK))) {
+              lStrength = std::min((size_t)probe.device->SignalStrength(), (size_t)100);
+              dlog(4, IntToStr(probe.key.first) + ": carrier, strength " + IntToStr(lStrength) + "%");
+              active.insert(probe.key);
+              probe.done = true;
+              pending--;
+              }
+           }
+        if (pending)
+           mSleep(20);
+        }
+     }
+  for(auto d:devices)
+     d->DetachAllReceivers();
+
+  size_t n = plan.size();
+  plan.erase(std::remove_if(plan.begin(), plan.end(), [&](const TScanPlanItem& item) {
+     return count[std::make_pair(item.Frequency, item.Polarization)] < 0;
+     }), plan.end());
+  dlog(4, "pre-sweep: " + IntToStr(active.size()) + " frequencies with carrier, " +
+          IntToStr(n - plan.size()) + " tuning attempts saved");
+}
+
+// returns true, as soon as one device is idle.
+bool cScanner::WaitForDevice(void) {
+  while(ActionAllowed()) {
+     {
+     const std::lock_guard<std::mutex> lock(jobMutex);
+     for(auto& job:jobs) {
+        if (job and !job->Active())
+           DeleteNullptr(job);
+        if (job == nullptr)
+           return true;
+        }
+     }
+     idle.Wait(100);
+     }
+  return false;
+}
+
+/* waits for all jobs to finish. Until then, each device which becomes idle
+ * gets a transponder found in a NIT, as long as there are untested ones left:
+ * the state machines of running jobs may take them as well, but a job whose
+ * initial transponder had no lock ends without ever asking for one.
+ */
+void cScanner::WaitForJobs(bool UseNit) {
+  for(bool busy = true; busy; ) {
+     busy = false;
+     {
+     const std::lock_guard<std::mutex> lock(jobMutex);
+     for(size_t i=0; i<jobs.size(); i++) {
+        cScanJob*& job = jobs[i];
+        if (job and !job->Active())
+           DeleteNullptr(job);
+        if (job == nullptr and UseNit and ActionAllowed()) {
+           TChannel* t = NextTransponder(devices[i]->CardIndex());
+           if (t)
+              job = new cScanJob(devices[i], t, UseNit, this, &idle, true);
+           }
+        if (job)
+           busy = true;
+        }
+     }
+     if (busy)
+        idle.Wait(100);
+     }
+}
+
+void cScanner::Dispatch(TChannel* Transponder, bool UseNit) {
+  const std::lock_guard<std::mutex> lock(jobMutex);
+  for(size_t i=0; i<jobs.size(); i++) {
+     if (jobs[i])
+        continue;
+     jobs[i] = new cScanJob(devices[i], Transponder, UseNit, this, &idle);
+     break;
+     }
+}
+
 void cScanner::Action(void) {
   bool crAuto, modAuto, invAuto, bwAuto, hAuto, tmAuto, gAuto, t2Support, roAuto, s2Support, vsbSupport, qamSupport;
   bool useNit = true;
-  bool isSatip = false;
   int f = 0;
   int mod_parm, modulation_min = 0, modulation_max = 1;
   int sr_parm, dvbc_symbolrate_min = 0, dvbc_symbolrate_max = 1;
-  int sys_parm = 0, thisSystem = -1;
-  int streamid_parm = 0;
+  int thisSystem = -1;
   int channel, channel_min = 0, channel_max = 133;
   int offs, freq_offset_min = 0, freq_offset_max = 2;
-  int this_channellist = DVBT_DE, this_bandwidth = 8, this_qam = 999, atsc = ATSC_VSB, dvb;
-  int qam_no_auto = 0, this_atsc = 0;
+  int this_channellist = DVBT_DE, this_bandwidth = 8, atsc = ATSC_VSB, dvb;
+  int qam_no_auto = 0;
   uint16_t frontend_type = SCAN_SATELLITE;
   std::string country   = country_to_short_name(wSetup.CountryIndex);
   std::string satellite = satellite_to_short_name(wSetup.SatIndex);
@@ -454,7 +741,6 @@ void cScanner::Action(void) {
         // min = T2, max = T
         modulation_min = t2Support ? 0 : 1;
         modulation_max = 1;
-        sys_parm = 0;
         // use srate as plp 0/1 to avoid a further loop.
         dvbc_symbolrate_min = 0;
         dvbc_symbolrate_max = t2Support ? 3 : 0;
@@ -690,321 +976,292 @@ void cScanner::Action(void) {
         return;
      } // end switch type
 
-  if (lDeviceName.compare(0, 6, "SAT>IP") == 0)
-     isSatip = true;
+  AddParallelDevices();
   if (MenuScanning)
      MenuScanning->SetStatus((status = 1));
 
-  //count channels.
-  switch(type) {
-     case SCAN_SATELLITE:
-     case SCAN_TRANSPONDER:
-        initialTransponders = channel_max;
-        break;
-     default:
-        // number depends on offset and symbolrates; counting in nested loops is easiest way.
-        for(mod_parm = modulation_min; mod_parm <= modulation_max; mod_parm++)
-           for(channel = channel_min; channel <= channel_max; channel++)
-              for(offs = freq_offset_min; offs <= freq_offset_max; offs++)
-                 for(sr_parm = dvbc_symbolrate_min; sr_parm <= dvbc_symbolrate_max; sr_parm++) {
-                    if ((! chan_to_freq(channel, this_channellist)) ||
-                        (freq_offset(channel, this_channellist, offs) == -1))
-                       continue;
-                    ++initialTransponders;
-                    }
-     } // switch(type)
-
-
-  cChannel c;
+  // compile the scan plan: all initial transponders in scan order, each once.
+  plan.clear();
+  {
+  char p[] = {'H','V','L','R'};
+  std::set<std::tuple<int,int,int,int,int,int,char>> unique;
 
   for(mod_parm = modulation_min; mod_parm <= modulation_max; mod_parm++) {
     for(channel = channel_min; channel <= channel_max; channel++) {
       for(offs = freq_offset_min; offs <= freq_offset_max; offs++)
         for(sr_parm = dvbc_symbolrate_min; sr_parm <= dvbc_symbolrate_max; sr_parm++) {
-          if (!ActionAllowed())
-             goto stop;
+          TScanPlanItem item = { 0, 0, 0, 0, 0, 0, 0, channel };
 
-          switch (type) {
+          switch(type) {
              case SCAN_TERRESTRIAL: {
                 std::array<int,2> DelSys = {1,0}; // {T2,T}
-                sys_parm = DelSys[mod_parm];      // NOTE: mod_parm is abused as 'system'
-                if (thisSystem != sys_parm) {
-                   thisSystem = sys_parm;
-                   std::string Gen2(sys_parm, '2');
-                   dlog(4, "Scanning DVB-T" + Gen2 + "...");
-                   }
+                item.DelSys = DelSys[mod_parm];   // NOTE: mod_parm is abused as 'system'
+                if (item.DelSys == 0 and sr_parm != dvbc_symbolrate_min)
+                   continue; // DVB-T: no plp, skip plp loop.
+                item.StreamId = item.DelSys ? sr_parm : 0; // NOTE: sr_parm is abused as 'plp'
 
-                if (sys_parm == 0) {
-                   // DVB-T: no plp, skip plp loop.
-                   streamid_parm = 0;
-                   sr_parm = dvbc_symbolrate_max;
-                   }
-                else {
-                   streamid_parm = sr_parm;  // NOTE: sr_parm is abused as 'plp'
-                   }
                 f = chan_to_freq(channel, this_channellist);
                 if (!f)
                    continue; //skip unused channels
-
                 if (freq_offset(channel, this_channellist, offs) == -1)
                    continue; //skip this one
 
-                f += freq_offset(channel, this_channellist, offs);
-                {
-                int bHz = bandwidth(channel, this_channellist), bvdr = bHz / 1000000;
-                if (bHz == 1712000) bvdr = 1712;
-
-                if (this_bandwidth != bvdr) {
-                   if (bvdr < 11)
-                      dlog(4, "Scanning " + IntToStr(bvdr) + "MHz frequencies...");
-                   else
-                      dlog(4, "Scanning " + FloatToStr(bvdr/1000.0,1,2,false) + "MHz frequencies...");
-                   }
-                this_bandwidth = bvdr;
-                }
-
-                aChannel->Source = "T";
-                aChannel->Frequency = f;
-                aChannel->Symbolrate = 0;
-                aChannel->Inversion = caps_inversion;
-                aChannel->Bandwidth = this_bandwidth;
-                aChannel->FEC = caps_fec;
-                aChannel->FEC_low =  caps_fec;
-                aChannel->Modulation = caps_qam;
-                aChannel->DelSys = sys_parm;
-                aChannel->Transmission = caps_transmission_mode;
-                aChannel->Guard = caps_guard_interval;
-                aChannel->Hierarchy = caps_hierarchy;
-                aChannel->NID = 0;
-                aChannel->TID = 0;
-                aChannel->SID = 0;
-                aChannel->RID = 0;
-                aChannel->StreamId = streamid_parm;
-                aChannel->SystemId = 0;
-
-                aChannel->PrintTransponder(s);
-                dlog(4, s);
-
-                if (known_transponder(aChannel, false)) {
-                   dlog(4, FloatToStr(aChannel->Frequency/1e6, 1, 3, false) +
-                        "MHz: skipped (already known transponder)");
-                   thisChannel++;
-                   Progress();
-                   continue;
-                   }
-                }
+                int bHz = bandwidth(channel, this_channellist);
+                item.Frequency  = f + freq_offset(channel, this_channellist, offs);
+                item.Bandwidth  = bHz == 1712000 ? 1712 : bHz / 1000000;
+                item.Modulation = caps_qam;
                 break;
+                }
              case SCAN_CABLE:
                 f = chan_to_freq(channel, this_channellist);
                 if (!f)
                    continue; //skip unused channels
-
                 if (freq_offset(channel, this_channellist, offs) == -1)
                    continue; //skip this one
 
-                f += freq_offset(channel, this_channellist, offs);
-                this_qam = caps_qam;
-                if (qam_no_auto > 0) {
-                   this_qam = dvbc_modulation(mod_parm);
-                   if ((int) aChannel->Modulation != this_qam)
-                      dlog(4, "searching M" + IntToStr(this_qam) + "...");
-                   }
-                else if (mod_parm > 0) {
+                if (qam_no_auto > 0)
+                   item.Modulation = dvbc_modulation(mod_parm);
+                else if (mod_parm > 0)
                    continue; // demod supports qam_auto, and we had one loop with QAM_AUTO.
-                   }
-
-                aChannel->Source = "C";
-                aChannel->Frequency = f / 1000;
-                aChannel->Symbolrate = dvbc_symbolrate(sr_parm) / 1000;
-                aChannel->Inversion = caps_inversion;
-                aChannel->Bandwidth = 999;
-                aChannel->FEC = caps_fec;
-                aChannel->Modulation = this_qam;
-                aChannel->DelSys = 0;
-                aChannel->NID = 0;
-                aChannel->TID = 0;
-                aChannel->SID = 0;
-                aChannel->RID = 0;
-
-                aChannel->PrintTransponder(s);
-                dlog(4, s);
-
-                if (known_transponder(aChannel, false)) {
-                   dlog(4, FloatToStr(aChannel->Frequency/1e3, 1, 3, false) +
-                        "MHz: skipped (already known transponder)");
-                   thisChannel++;
-                   Progress();
-                   continue;
-                   }
+                else
+                   item.Modulation = caps_qam;
+                item.Frequency  = (f + freq_offset(channel, this_channellist, offs)) / 1000;
+                item.Symbolrate = dvbc_symbolrate(sr_parm) / 1000;
                 break;
-             case SCAN_SATELLITE:
-                {
-                auto& sat = sat_list[this_channellist];
-                auto& tp = sat.items[channel];
-                aChannel->Source = sat.source_id;
-                aChannel->Frequency  = tp.intermediate_frequency;
-                aChannel->Symbolrate = tp.symbol_rate;
-                aChannel->DelSys     = tp.modulation_system == 6 ? 1:0;
-                aChannel->StreamId   = tp.stream_id;
-
-                char p[] = {'H','V','L','R'};
-                aChannel->Polarization = p[tp.polarization];
-
-                int f[] = {0,12,23,34,45,56,67,78,89,999,35,910};
-                aChannel->FEC = f[tp.fec_inner];
-
-                int m[] = {2,16,32,64,128,256,999,10,11,5,6,7,12,0};
-                aChannel->Modulation = m[tp.modulation_type];
-
-                int r[] = {35,20,25,999};
-                aChannel->Rolloff = r[tp.rolloff];
-
-                aChannel->Pilot = 999;
-                aChannel->NID = 0;
-                aChannel->TID = 0;
-                aChannel->SID = 0;
-                aChannel->RID = 0;
-                }
-
+             case SCAN_SATELLITE: {
+                auto& tp = sat_list[this_channellist].items[channel];
+                item.Frequency    = tp.intermediate_frequency;
+                item.Symbolrate   = tp.symbol_rate;
+                item.DelSys       = tp.modulation_system == 6 ? 1:0;
+                item.StreamId     = tp.stream_id;
+                item.Polarization = p[tp.polarization];
+
+                aChannel->Source       = sat_list[this_channellist].source_id;
+                aChannel->Frequency    = item.Frequency;
+                aChannel->Polarization = item.Polarization;
                 if (! aChannel->ValidSatIf())
                    continue;
- 
-                aChannel->Print(s);
-                dlog(4, s);
-
-                ///orbital_position = sat_list[this_channellist].orbital_position;
-                ///west_east_flag   = sat_list[this_channellist].west_east_flag;
-                if (sat_list[this_channellist].items[channel].modulation_system == 6) {
-                   if (not(caps_s2)) {
-                      dlog(4, IntToStr(sat_list[this_channellist].items[channel].intermediate_frequency) +
-                              ": skipped (no S2 support)");
-                      thisChannel++;
-                      Progress();
-                      continue;
-                      }
-                   }
-                
-                if (known_transponder(aChannel, false)) {
-                   dlog(4, FloatToStr(aChannel->Frequency/1e0, 1, 3, false) +
-                        ": skipped (already known transponder)");
-                   thisChannel++;
+
+                if (item.DelSys and not caps_s2) {
+                   dlog(4, IntToStr(item.Frequency) + ": skipped (no S2 support)");
                    continue;
                    }
                 break;
+                }
              case SCAN_TERRCABLE_ATSC:
                 switch(mod_parm) {
-                   case ATSC_VSB:
-                      this_atsc = 10;
-                      f = chan_to_freq(channel, ATSC_VSB);
-                      if (!f)
-                         continue; //skip unused channels
-
-                      if (freq_offset(channel, ATSC_VSB, offs) == -1)
-                         continue; //skip this one
-
-                      f += freq_offset(channel, ATSC_VSB, offs);
-                      break;
-                   case ATSC_QAM:
-                      this_atsc = 256;
-                      f = chan_to_freq(channel, ATSC_QAM);
-                      if (!f)
-                         continue; //skip unused channels
-
-                      if (freq_offset(channel, ATSC_QAM, offs) == -1)
-                         continue; //skip this one
-
-                      f += freq_offset(channel, ATSC_QAM, offs);
-                      break;
+                   case ATSC_VSB: item.Modulation = 10;  break;
+                   case ATSC_QAM: item.Modulation = 256; break;
                    default:
                       dlog(0, "unknown atsc modulation id " + IntToStr(mod_parm));
                       return;
-                   } // end switch mod_parm
-                //fixme: vsb vs qam here
-                aChannel->Source = "A";
-                aChannel->Frequency = f / 1000;
-                aChannel->Symbolrate = dvbc_symbolrate(sr_parm) / 1000;
-                aChannel->Modulation = this_atsc;
-                aChannel->Inversion = caps_inversion;
-                aChannel->FEC = caps_fec;
-                aChannel->DelSys = 0;
-                aChannel->NID = 0;
-                aChannel->TID = 0;
-                aChannel->SID = 0;
-                aChannel->RID = 0;
-
-                aChannel->PrintTransponder(s);
-                dlog(4, s);
-
-                if (known_transponder(aChannel, false)) {
-                   dlog(4, FloatToStr(aChannel->Frequency/1e6, 1, 3, false) +
-                        "MHz M" + IntToStr(this_atsc) + ": skipped (already known transponder)");
-                   thisChannel++;
-                   Progress();
-                   continue;
                    }
-                break;
+                f = chan_to_freq(channel, mod_parm);
+                if (!f)
+                   continue; //skip unused channels
+                if (freq_offset(channel, mod_parm, offs) == -1)
+                   continue; //skip this one
 
+                item.Frequency  = (f + freq_offset(channel, mod_parm, offs)) / 1000;
+                item.Symbolrate = dvbc_symbolrate(sr_parm) / 1000;
+                break;
              case SCAN_TRANSPONDER:
-                aChannel->PrintTransponder(s);
-                dlog(4, s);
+                // aChannel was set from the user transponder already.
                 break;
              default:;
              } // end switch type
-          ++thisChannel;
-          lStrength = 0;
-          Progress();
-          lTransponder = s.c_str();
-          if (MenuScanning) {
-             MenuScanning->SetTransponder(aChannel);
-             }
-          aChannel->Tested = false;
-          int nid = aChannel->NID;
-          int sid = aChannel->SID;
-          aChannel->NID = 0x2000;
-          aChannel->SID = 0x2000;
-          aChannel->VdrChannel(c);
-          aChannel->NID = nid;
-          aChannel->SID = sid;          
-          dev->SwitchChannel(&c, false);
-
-          {
-          bool lock;
-
-          if (MenuScanning)
-             MenuScanning->SetStr(0, false);
-
-          mSleep(wSetup.SignalWaitTime * 1000);
-          if (isSatip or GetFrontendStatus(dev) & FE_HAS_SIGNAL) 
-             lock = dev->HasLock(wSetup.LockTimeout * 1000);
-          else
-             lock = false;
-
-          if (lock) {
-             lStrength = std::min((size_t)dev->SignalStrength(), (size_t)100);
-             if (MenuScanning)
-                MenuScanning->SetStr(lStrength, lock);
-             StateMachine = new cStateMachine(dev, aChannel, useNit, this);
-             while(StateMachine && StateMachine->Active())
-                mSleep(100);
-             DeleteNullptr(StateMachine);
-             }
-           }
-
 
-          if (dev)
-             dev->DetachAllReceivers();
+          if (unique.insert(std::make_tuple(item.Frequency, item.Symbolrate, item.Modulation, item.Bandwidth,
+                                            item.DelSys, item.StreamId, item.Polarization)).second)
+             plan.push_back(item);
           } // end loop sr_parm
        } // end loop channel
     } // end loop mod_parm
+  }
+
+  // sets aChannel to the tuning parameters of one scan plan item.
+  auto SetChannel = [&](const TScanPlanItem& item) {
+     switch(type) {
+        case SCAN_TERRESTRIAL:
+           aChannel->Source = "T";
+           aChannel->Frequency = item.Frequency;
+           aChannel->Symbolrate = 0;
+           aChannel->Inversion = caps_inversion;
+           aChannel->Bandwidth = item.Bandwidth;
+           aChannel->FEC = caps_fec;
+           aChannel->FEC_low =  caps_fec;
+           aChannel->Modulation = item.Modulation;
+           aChannel->DelSys = item.DelSys;
+           aChannel->Transmission = caps_transmission_mode;
+           aChannel->Guard = caps_guard_interval;
+           aChannel->Hierarchy = caps_hierarchy;
+           aChannel->StreamId = item.StreamId;
+           aChannel->SystemId = 0;
+           break;
+        case SCAN_CABLE:
+           aChannel->Source = "C";
+           aChannel->Frequency = item.Frequency;
+           aChannel->Symbolrate = item.Symbolrate;
+           aChannel->Inversion = caps_inversion;
+           aChannel->Bandwidth = 999;
+           aChannel->FEC = caps_fec;
+           aChannel->Modulation = item.Modulation;
+           aChannel->DelSys = 0;
+           break;
+        case SCAN_SATELLITE: {
+           auto& sat = sat_list[this_channellist];
+           auto& tp = sat.items[item.Index];
+           aChannel->Source = sat.source_id;
+           aChannel->Frequency  = item.Frequency;
+           aChannel->Symbolrate = item.Symbolrate;
+           aChannel->DelSys     = item.DelSys;
+           aChannel->StreamId   = item.StreamId;
+           aChannel->Polarization = item.Polarization;
+
+           int f[] = {0,12,23,34,45,56,67,78,89,999,35,910};
+           aChannel->FEC = f[tp.fec_inner];
+
+           int m[] = {2,16,32,64,128,256,999,10,11,5,6,7,12,0};
+           aChannel->Modulation = m[tp.modulation_type];
+
+           int r[] = {35,20,25,999};
+           aChannel->Rolloff = r[tp.rolloff];
+
+           aChannel->Pilot = 999;
+           break;
+           }
+        case SCAN_TERRCABLE_ATSC:
+           //fixme: vsb vs qam here
+           aChannel->Source = "A";
+           aChannel->Frequency = item.Frequency;
+           aChannel->Symbolrate = item.Symbolrate;
+           aChannel->Modulation = item.Modulation;
+           aChannel->Inversion = caps_inversion;
+           aChannel->FEC = caps_fec;
+           aChannel->DelSys = 0;
+           break;
+        default:
+           return;
+        }
+     aChannel->NID = 0;
+     aChannel->TID = 0;
+     aChannel->SID = 0;
+     aChannel->RID = 0;
+     };
+
+  PreSweep(SetChannel);
+  initialTransponders = plan.size();
+  dlog(5, "scan plan: " + IntToStr(initialTransponders) + " transponders");
+
+
+  for(auto& item:plan) {
+     if (!ActionAllowed() or !WaitForDevice())
+        goto stop;
+
+     switch (type) {
+        case SCAN_TERRESTRIAL:
+           if (thisSystem != item.DelSys) {
+              thisSystem = item.DelSys;
+              std::string Gen2(item.DelSys, '2');
+              dlog(4, "Scanning DVB-T" + Gen2 + "...");
+              }
+           if (this_bandwidth != item.Bandwidth) {
+              if (item.Bandwidth < 11)
+                 dlog(4, "Scanning " + IntToStr(item.Bandwidth) + "MHz frequencies...");
+              else
+                 dlog(4, "Scanning " + FloatToStr(item.Bandwidth/1000.0,1,2,false) + "MHz frequencies...");
+              this_bandwidth = item.Bandwidth;
+              }
+           SetChannel(item);
+           aChannel->PrintTransponder(s);
+           dlog(4, s);
+
+           if (known_transponder(aChannel, false)) {
+              dlog(4, FloatToStr(aChannel->Frequency/1e6, 1, 3, false) +
+                   "MHz: skipped (already known transponder)");
+              thisChannel++;
+              Progress();
+              continue;
+              }
+           break;
+        case SCAN_CABLE:
+           if (qam_no_auto > 0 and aChannel->Modulation != item.Modulation)
+              dlog(4, "searching M" + IntToStr(item.Modulation) + "...");
+           SetChannel(item);
+           aChannel->PrintTransponder(s);
+           dlog(4, s);
+
+           if (known_transponder(aChannel, false)) {
+              dlog(4, FloatToStr(aChannel->Frequency/1e3, 1, 3, false) +
+                   "MHz: skipped (already known transponder)");
+              thisChannel++;
+              Progress();
+              continue;
+              }
+           break;
+        case SCAN_SATELLITE:
+           SetChannel(item);
+           aChannel->Print(s);
+           dlog(4, s);
+
+           if (known_transponder(aChannel, false)) {
+              dlog(4, FloatToStr(aChannel->Frequency/1e0, 1, 3, false) +
+                   ": skipped (already known transponder)");
+              thisChannel++;
+              Progress();
+              continue;
+              }
+           break;
+        case SCAN_TERRCABLE_ATSC:
+           SetChannel(item);
+           aChannel->PrintTransponder(s);
+           dlog(4, s);
+
+           if (known_transponder(aChannel, false)) {
+              dlog(4, FloatToStr(aChannel->Frequency/1e6, 1, 3, false) +
+                   "MHz M" + IntToStr(item.Modulation) + ": skipped (already known transponder)");
+              thisChannel++;
+              Progress();
+              continue;
+              }
+           break;
+
+        case SCAN_TRANSPONDER:
+           aChannel->PrintTransponder(s);
+           dlog(4, s);
+           break;
+        default:;
+        } // end switch type
+     ++thisChannel;
+     lStrength = 0;
+     Progress();
+     {
+     const std::lock_guard<std::mutex> lock(lMutex);
+     lTransponder = s.c_str();
+     }
+     if (MenuScanning) {
+        MenuScanning->SetTransponder(aChannel);
+        }
+     aChannel->Tested = false;
+     Dispatch(aChannel, useNit);
+     } // end loop plan
 
 
 stop:
+  if (!ActionAllowed())
+     SetShouldstop(true);
+  WaitForJobs(useNit);
+  LockProfiles.Save();
+  SiCache.Save();
+  dlog(4, "scan channels: " + IntToStr(ScanChannels.Count()) + " allocated, " +
+          IntToStr(ScanChannels.InUse()) + " in use, " +
+          IntToStr(ScanChannels.Reused()) + " reused");
   AddChannels();
   if (MenuScanning)
      MenuScanning->SetStatus((status = 0));
 
-  if (dev)
-     dev->DetachAllReceivers();
+  for(auto d:devices)
+     d->DetachAllReceivers();
 
   //Channels.ReNumber();
   SetShouldstop(true);
@@ -1020,78 +1277,110 @@ stop:
  */
 #include <vdr/channels.h>
 
-void cScanner::AddChannels(void) {
-  cStateKey WriteState;
-  cChannels* WChannels = (cChannels*) cChannels::GetChannelsWrite(WriteState, 30000);
+/* (source, ONID, TID, SID) of a channel, the key to compare NewChannels with
+ * vdr's channels.
+ */
+struct TChannelId {
+  int Source;
+  int ONID;
+  int TID;
+  int SID;
+  bool operator==(const TChannelId& rhs) const {
+     return Source == rhs.Source and ONID == rhs.ONID and TID == rhs.TID and SID == rhs.SID;
+     }
+};
 
-  extern TChannels NewChannels;
+struct TChannelIdHash {
+  size_t operator()(const TChannelId& id) const {
+     uint64_t k = ((uint64_t) (id.ONID & 0xFFFF) << 32) | ((uint64_t) (id.TID & 0xFFFF) << 16) | (id.SID & 0xFFFF);
+     return std::hash<uint64_t>()(k ^ ((uint64_t) id.Source << 24));
+     }
+};
 
-  if (!WChannels)
-     return;
+static TChannelId ChannelId(const cChannel* c) {
+  TChannelId id = { c->Source(), c->Nid(), c->Tid(), c->Sid() };
+  return id;
+}
 
-  for(int i = 0; i < WChannels->Count(); i++) {
-     const cChannel* ch = WChannels->Get(i);
-     TChannel* newCh = nullptr;
-     int source = 0;
-
-     // is 'ch' known in NewChannels?
-     for(int idx = 0; idx < NewChannels.Count(); idx++) {
-        if (!source)
-            source = cSource::FromString(NewChannels[idx]->Source.c_str());
-
-        if (ch->Nid() != NewChannels[idx]->ONID or
-            ch->Tid() != NewChannels[idx]->TID or
-            ch->Sid() != NewChannels[idx]->SID or
-            ch->Source() != cSource::FromString(NewChannels[idx]->Source.c_str()))
-           continue;
+/* The changes to vdr's channel list are computed first, while holding only
+ * the read lock. The write lock, which blocks recordings and EPG, is held
+ * just to apply them.
+ */
+void cScanner::AddChannels(void) {
+  extern TChannels NewChannels;
+  std::unordered_map<TChannelId, std::string, TChannelIdHash> found;   // NewChannels, first one wins
+  std::vector<TChannelId> ids;                                         // NewChannels order
+  std::unordered_set<TChannelId, TChannelIdHash> remove;
+  std::unordered_map<TChannelId, std::string, TChannelIdHash> update;
+  std::map<std::string, int> sources;
+  int source = 0;
+
+  for(auto n:NewChannels.Lock()) {
+     auto it = sources.find(n->Source);
+     if (it == sources.end())
+        it = sources.insert(std::make_pair(n->Source, cSource::FromString(n->Source.c_str()))).first;
+     if (!source)
+        source = it->second;
+     TChannelId id = { it->second, n->ONID, n->TID, n->SID };
+     if (found.count(id))
+        continue;
+     n->Print(found[id]);
+     ids.push_back(id);
+     }
 
-        // this channel is already known.
-        newCh = NewChannels[idx];
-        break;
+  {
+  cStateKey ReadState;
+  const cChannels* RChannels = cChannels::GetChannelsRead(ReadState, 30000);
+  if (!RChannels)
+     return;
+  for(const cChannel* ch = RChannels->First(); ch; ch = RChannels->Next(ch)) {
+     TChannelId id = ChannelId(ch);
+     auto it = found.find(id);
+     if (it == found.end()) {
+        // existing channel not found by IDs
+        if (wSetup.scan_remove_invalid and ch->Source() == source)
+           remove.insert(id);
+        continue;
         }
+     if (wSetup.scan_update_existing and it->second != *ch->ToText())
+        update[id] = it->second;
+     }
+  ReadState.Remove();
+  }
 
+  cStateKey WriteState;
+  cChannels* WChannels = (cChannels*) cChannels::GetChannelsWrite(WriteState, 30000);
+  if (!WChannels)
+     return;
 
-     // existing channel not found by IDs
-     if (wSetup.scan_remove_invalid and !newCh and ch->Source() == source) {
+  std::unordered_set<TChannelId, TChannelIdHash> existing;
+  for(int i = 0; i < WChannels->Count(); i++) {
+     cChannel* ch = WChannels->Get(i);
+     TChannelId id = ChannelId(ch);
+     if (remove.count(id)) {
         dlog(4, "remove invalid channel '" + std::string(*ch->ToText()) + "'");
-        WChannels->Del((cChannel*) ch);
+        WChannels->Del(ch);
         i--;
         continue;
         }
-
-     // update existing
-     if (wSetup.scan_update_existing and newCh) {
-        std::string s;
-        newCh->Print(s);
-        if (s != *ch->ToText()) {
-           ((cChannel*) ch)->Parse(s.c_str());
-           dlog(4, "updated channel '" + std::string(*ch->ToText()) + "'");
-           }
+     auto u = update.find(id);
+     if (u != update.end()) {
+        ch->Parse(u->second.c_str());
+        dlog(4, "updated channel '" + std::string(*ch->ToText()) + "'");
         }
+     existing.insert(id);
      }
 
-  if (wSetup.scan_append_new)
-  for(int i=0; i<NewChannels.Count(); i++) {
-     TChannel* n = NewChannels[i];
-     const cChannel* old = nullptr;
-
-     for(old = WChannels->First(); old; old = WChannels->Next(old)) {
-        if (old->Nid() == n->ONID and
-            old->Tid() == n->TID and
-            old->Sid() == n->SID and
-            *cSource::ToString(old->Source()) == n->Source) {
-           break;
-           }
-        }
-
-     if (!old) {
-        std::string s;
+  if (wSetup.scan_append_new) {
+     for(auto& id:ids) {
+        if (existing.count(id))
+           continue;
+        const std::string& s = found[id];
         cChannel* c = new cChannel;
-        n->Print(s);
         c->Parse(s.c_str());
         dlog(4, "Add channel '" + s + "'");
         WChannels->Add(c);
-        }           
+        }
      }
   WChannels->ReNumber();
   WriteState.Remove();
@@ -3,13 +3,63 @@
  * See the README file for copyright information and how to reach the author.
  ******************************************************************************/
 #pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include <repfunc.h>
+#include "common.h" // cScanEvent
 
 class cDevice;
 class cDvbDevice;
 class TChannel;
 class cStateMachine;
 
+
+/*******************************************************************************
+ * struct TScanPlanItem, one initial transponder of a scan.
+ ******************************************************************************/
+struct TScanPlanItem {
+  int  Frequency;
+  int  Symbolrate;
+  int  Modulation;
+  int  Bandwidth;
+  int  DelSys;
+  int  StreamId;
+  char Polarization;
+  int  Index;        // channel number; satellite: index of sat_list[].items
+};
+
+
+/*******************************************************************************
+ * class cScanJob
+ * tunes one device to one initial transponder and runs a cStateMachine on it.
+ * A transponder found in a NIT is handed to the state machine untuned: it tunes
+ * itself and records the transponder also if there's no lock.
+ ******************************************************************************/
+class cScanJob : public ThreadBase {
+private:
+  cDevice*   dev;
+  TChannel*  transponder;  // a copy; if discovered, the entry of NewTransponders itself
+  bool       useNit;
+  void*      parent;
+  bool       discovered;  // from a NIT, not from the scan plan
+  std::atomic<bool> stop;
+  cScanEvent done;        // signaled by the state machine on exit
+  cScanEvent* idle;       // signaled on exit
+protected:
+  virtual void Action(void);
+public:
+  cScanJob(cDevice* Dev, TChannel* Transponder, bool UseNit, void* Parent, cScanEvent* Idle, bool Discovered = false);
+  virtual ~cScanJob(void);
+  void DoStop(void) { stop = true; done.Signal(); };
+  bool Active(void) { return Running(); };
+};
+
+
+/*******************************************************************************
+ * class cScanner
+ ******************************************************************************/
 class cScanner : public ThreadBase {
 private:
   bool       shouldstop;
@@ -22,10 +72,19 @@ private:
   int        type;
   cDevice*   dev;
   TChannel*  aChannel;
-  cStateMachine* StateMachine;
+  std::vector<cDevice*> devices;  // devices[0] == dev; more than one if wSetup.ParallelScan
+  std::vector<cScanJob*> jobs;    // one slot per device
+  std::mutex jobMutex;
+  std::vector<TScanPlanItem> plan;
+  cScanEvent idle;                // signaled if a job finished
 protected:
   virtual void Action(void);
   void AddChannels(void);
+  void AddParallelDevices(void);
+  void PreSweep(std::function<void(const TScanPlanItem&)> SetChannel);
+  bool WaitForDevice(void);
+  void WaitForJobs(bool UseNit);
+  void Dispatch(TChannel* Transponder, bool UseNit);
 public:
   cScanner(const char* Description, int Type);
   virtual ~cScanner(void);
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>      // strtol()
+#include "sicache.h"
+#include "common.h"       // dlog(), IntToStr()
+
+cSiCache SiCache;
+
+// ie. "S19.2E:40:1"
+std::string cSiCache::Key(std::string Source, int TableId, int Extension) {
+  return Source + ':' + IntToHex(TableId, 2) + ':' + IntToStr(Extension);
+}
+
+void cSiCache::Add(const std::string& Key, int Version, int Section, int LastSection, const unsigned char* Data, int Length) {
+  const std::lock_guard<std::mutex> lock(m);
+  TSubTable& t = tables[Key];
+  if (t.version != Version or (int) t.sections.size() != LastSection + 1) {
+     t.version = Version;
+     t.sections.clear();
+     t.sections.resize(LastSection + 1);
+     }
+  if (Section > LastSection or t.sections[Section] == TSection(Data, Data + Length))
+     return;
+  t.sections[Section].assign(Data, Data + Length);
+  modified = true;
+}
+
+bool cSiCache::Get(const std::string& Key, int Version, int Section, int LastSection, const unsigned char* Data, int Length,
+                   std::vector<TSection>& Sections) {
+  const std::lock_guard<std::mutex> lock(m);
+  auto it = tables.find(Key);
+  if (it == tables.end() or it->second.version != Version or
+      (int) it->second.sections.size() != LastSection + 1 or Section > LastSection or
+      it->second.sections[Section] != TSection(Data, Data + Length))
+     return false;
+  for(auto& s:it->second.sections)
+     if (s.empty())
+        return false;
+  Sections = it->second.sections;
+  return true;
+}
+
+/* file format, one line per section:
+ * <key> ' ' <version> ' ' <section_number> ' ' <last_section_number> ' ' <hex data>
+ */
+void cSiCache::Load(std::string FileName) {
+  const std::lock_guard<std::mutex> lock(m);
+  std::ifstream f(FileName);
+  std::string line;
+
+  fileName = FileName;
+  tables.clear();
+  while(std::getline(f, line)) {
+     std::stringstream ss(line);
+     std::string key, hex;
+     int version, section, last;
+     if (!(ss >> key >> version >> section >> last >> hex) or
+         section < 0 or section > last or last > 255 or hex.size() % 2)
+        continue;
+
+     TSubTable& t = tables[key];
+     if (t.sections.empty() or t.version != version) {
+        t.version = version;
+        t.sections.clear();
+        t.sections.resize(last + 1);
+        }
+     if ((int) t.sections.size() != last + 1)
+        continue;
+     TSection& s = t.sections[section];
+     s.clear();
+     for(size_t i = 0; i < hex.size(); i += 2)
+        s.push_back(strtol(hex.substr(i, 2).c_str(), nullptr, 16));
+     }
+  modified = false;
+  dlog(5, "read " + IntToStr(tables.size()) + " SI tables from " + FileName);
+}
+
+void cSiCache::Save(void) {
+  const std::lock_guard<std::mutex> lock(m);
+  if (!modified or fileName.empty())
+     return;
+
+  std::ofstream f(fileName, std::ios::trunc);
+  if (!f) {
+     dlog(0, "could not write " + fileName);
+     return;
+     }
+  static const char digits[] = "0123456789ABCDEF";
+  for(auto& t:tables) {
+     for(size_t i = 0; i < t.second.sections.size(); i++) {
+        const TSection& s = t.second.sections[i];
+        if (s.empty())
+           continue;
+        f << t.first << ' ' << t.second.version << ' ' << i << ' ' << t.second.sections.size() - 1 << ' ';
+        for(auto c:s)
+           f << digits[c >> 4] << digits[c & 15];
+        f << std::endl;
+        }
+     }
+  modified = false;
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+/*******************************************************************************
+ * class cSiCache
+ * raw sections of network wide SI sub-tables (the NIT), keyed by
+ * source, table_id and table_id_extension. Once a sub-table was seen complete,
+ * later transponders of that network replay it from here as soon as the first
+ * section received live is the same, byte for byte, as the cached one with
+ * the same section_number.
+ ******************************************************************************/
+class cSiCache {
+private:
+  typedef std::vector<unsigned char> TSection;
+  struct TSubTable {
+     int version;
+     std::vector<TSection> sections;   // index: section_number, empty if missing
+  };
+  std::mutex m;
+  std::map<std::string, TSubTable> tables;
+  std::string fileName;
+  bool modified;
+public:
+  cSiCache(void) : modified(false) {}
+  static std::string Key(std::string Source, int TableId, int Extension);
+  void Add(const std::string& Key, int Version, int Section, int LastSection, const unsigned char* Data, int Length);
+  // copies all sections of Key, if it's complete, has this version and last
+  // section number and if Data is the same as its cached section.
+  bool Get(const std::string& Key, int Version, int Section, int LastSection, const unsigned char* Data, int Length,
+           std::vector<TSection>& Sections);
+  void Load(std::string FileName);
+  void Save(void);
+};
+
+extern cSiCache SiCache;
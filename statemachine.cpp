@@ -4,8 +4,9 @@
  ******************************************************************************/
 
 #include <string>
-#include <algorithm>      // std::min()
-#include <vdr/receiver.h>
+#include <mutex>
+#include <vector>         // std::vector<>
+#include <algorithm>      // std::min(), std::max()
 #include "tlist.h"
 #include "scanner.h"
 #include "statemachine.h"
@@ -20,49 +21,13 @@ extern TChannels NewTransponders;
 extern TChannels ScannedTransponders;
 
 
-/*******************************************************************************
- * class cScanReceiver
- * a dummy receiver. Might be used real later.
- ******************************************************************************/
-  
-class cScanReceiver : public cReceiver, public ThreadBase {
-private:
-protected:
-  virtual void Activate(bool On);
-  virtual void Receive(const uchar* Data, int Length);
-  virtual void Action(void);
-public:
-  cScanReceiver();
-  virtual ~cScanReceiver();
-};
-
-cScanReceiver::cScanReceiver() : cReceiver(nullptr, 99) {}
-
-cScanReceiver::~cScanReceiver() {
-  cReceiver::Detach();
-}
-
-void cScanReceiver::Receive(const uchar* Data, int Length) {}
-
-void cScanReceiver::Action(void) {
-  while(Running())
-     std::this_thread::sleep_for(std::chrono::milliseconds(5));
-};
-
-void cScanReceiver::Activate(bool On) {
-  if (On) Start();
-  else Cancel();
-};
-
-
-
 /*******************************************************************************
  * class cStateMachine
  ******************************************************************************/
 
-cStateMachine::cStateMachine(cDevice* Dev, TChannel* InitialTransponder, bool UseNit, void* Parent) :
+cStateMachine::cStateMachine(cDevice* Dev, TChannel* InitialTransponder, bool UseNit, void* Parent, cScanEvent* Done) :
   state(eStart), lastState(eStop), initial(InitialTransponder), dev(Dev),
-  dvbdevice(nullptr), stop(false), useNit(UseNit), parent(Parent)
+  dvbdevice(nullptr), stop(false), useNit(UseNit), parent(Parent), done(Done)
 { 
   Start();
 }
@@ -75,6 +40,7 @@ cStateMachine::~cStateMachine(void) {
 
 void cStateMachine::DoStop(void) {
   stop = true;
+  event.Signal();
 }
 
 
@@ -110,29 +76,65 @@ void cStateMachine::Report(eState State) {
 TSdtData SdtData;
 TNitData NitData;
 
+/* SdtData, NitData and the NIT derived lists are shared between all
+ * state machines. Each state machine collects the tables of its transponder
+ * on its own, but only one at a time may merge and evaluate them.
+ */
+static std::mutex TablesMutex;
+
+// true, if SDT other of an earlier transponder listed all services of this one,
+// ie. all sections of its SDT other sub-table were seen.
+static bool KnownSdt(const TChannel* Transponder) {
+  if (!Transponder->TID or !Transponder->ONID)
+     return false;
+  const std::lock_guard<std::mutex> lock(TablesMutex);
+  return SdtData.complete_other.count(Transponder->ONID << 16 | Transponder->TID) > 0;
+}
+
+// stops a section scanner and waits for its thread to finish.
+template<class T> static void StopScanner(T*& Scanner) {
+  if (Scanner == nullptr)
+     return;
+  Scanner->Stop();
+  while(Scanner->Running())
+     mSleep(10);
+  DeleteNullptr(Scanner);
+}
+
 // v 0.0.5, StateMachine itself
 void cStateMachine::Action(void) {
   TChannel* Transponder = nullptr;
   cScanReceiver* aReceiver = nullptr;
+  cScanReceiver* demux = nullptr;     // aReceiver, if attached; nullptr: hardware section filters
   cPatScanner* PatScanner = nullptr;
   cNitScanner* NitScanner = nullptr;
   cSdtScanner* SdtScanner = nullptr;
   eState newState = state;
   cScanner* scanner = (cScanner*)parent;
   int dvbtype = scanner->DvbType();
-  dvbdevice = scanner->DvbDevice();
+  dvbdevice = GetDvbDevice(dev);
   std::string s;
+  std::unique_lock<std::mutex> tables(TablesMutex, std::defer_lock);
+  time_t tm = 0;
 
   TList<cPmtScanner*> PmtScanners;
+  cPmtPool* PmtPool = nullptr;
   struct TPatData PatData;
   TList<TPmtData*> PmtData;
+  TArena<TPmtData> PmtArena;           // owns PmtData, cleared for each transponder.
+
+  TNitData nitData;
+  TSdtData sdtData;
+  uint16_t nitPid = 0x10;
 
   bool pmtstart = false;
   bool tblstart = false;
 
-  while (Running() && !stop) {
-     mSleep(10);
+  PmtScanners.Shared(false);           // owned by this thread only.
 
+  // the section scanners signal 'event' as soon as they finish, so waiting
+  // states sleep until then instead of polling every 10ms.
+  while (Running() && !stop) {
      Report(state);
 
      switch(state) {
@@ -152,7 +154,10 @@ void cStateMachine::Action(void) {
         case eTune: {
            Transponder->PrintTransponder(s);
            dlog(4, "tuning to " + s);
+           {
+           const std::lock_guard<std::mutex> lock(lMutex);
            lTransponder = s;
+           }
 
            if (MenuScanning)
               MenuScanning->SetTransponder(Transponder);
@@ -171,35 +176,49 @@ void cStateMachine::Action(void) {
            Transponder->SID = 0x2000;
 
            Transponder->VdrChannel(c);
+           uint32_t before = GetFrontendFrequency(dev);
            dev->SwitchChannel(&c, false);
 
            Transponder->NID = nid;
            Transponder->SID = sid;
 
-           aReceiver = new cScanReceiver();
-           dev->AttachReceiver(aReceiver);
+           // PAT, NIT and SDT are on fixed PIDs: set them before attaching, so that
+           // only the PMTs in eScanPmt re-attach the receiver.
+           aReceiver = new cScanReceiver(dev, { SI_EXT::PID_PAT, wSetup.DVBC_Network_PID, SI_EXT::PID_SDT });
+           demux = dev->AttachReceiver(aReceiver) ? aReceiver : nullptr;
 
-           TChannel* tp = new TChannel;
+           TChannel* tp = ScanChannels.New();
            tp->CopyTransponderData(Transponder);
            tp->Tested = true;
            tp->PrintTransponder(s);
 
-           mSleep(wSetup.SignalWaitTime * 1000);
-           if (dev->HasLock(wSetup.LockTimeout * 1000)) {
+           if (WaitForLock(dev, Transponder, before)) {
               dev->SetOccupied(90);
               dlog(4, "lock.");
               tp->Tunable = true;
               newState = eScanPat;
+
+              // NIT and SDT are on fixed PIDs: start them together with PAT.
+              // some stupid cable providers use non-standard PID for NIT; sometimes called 'Setup-PID'.
+              nitPid = wSetup.DVBC_Network_PID;
+              nitData.OrbitalPos = initial->OrbitalPos;
+              nitData.West       = initial->West;
+              NitScanner = new cNitScanner(dev, nitPid, nitData, dvbtype, demux, &event);
+              if (!wSetup.SdtOther or !KnownSdt(Transponder))
+                 SdtScanner = new cSdtScanner(dev, sdtData, demux, &event, wSetup.SdtOther);
+              else
+                 dlog(4, "services of TID " + IntToStr(Transponder->TID) + " known from SDT other");
               }
            else {
               dev->Detach(aReceiver);
+              demux = nullptr;
               DeleteNullptr(aReceiver);
               tp->Tunable = false;
               newState = eNextTransponder;
               }
 
            dlog(4, "ScannedTransponders.Add: '" + s + "'");
-           ScannedTransponders.Add(tp);
+           AddScannedTransponder(tp);
 
            lStrength = std::min((size_t)dev->SignalStrength(), (size_t)100);
 
@@ -214,17 +233,8 @@ void cStateMachine::Action(void) {
                goto DIRECT_EXIT;
 
            newState = eStop;
-           if (NewTransponders.Count()) {
-              Transponder = nullptr;
-              for(int i = 0; i < NewTransponders.Count(); i++) {
-                 if (NewTransponders[i]->Tested)
-                    continue;
-                 NewTransponders[i]->Tested = true;
-                 Transponder = NewTransponders[i];
-                 newState = eTune;
-                 break;
-                 }
-              }
+           if ((Transponder = NextTransponder(dev->CardIndex())) != nullptr)
+              newState = eTune;
 
            lProgress = 0.5 + (100.0 * (scanner->ThisChannel() + ScannedTransponders.Count()) / (NewTransponders.Count() + scanner->InitialTransponders()));
            if (MenuScanning) {
@@ -235,10 +245,16 @@ void cStateMachine::Action(void) {
            break;
            }
         case eDetachReceiver:
+           // NIT and SDT may still run, if there was no PAT or on stop.
+           StopScanner(NitScanner);
+           StopScanner(SdtScanner);
+           ClearTables(nitData, sdtData);
+
            if (dev) {
               dev->DetachAllReceivers();
               dev->SetOccupied(0);
               }
+           demux = nullptr;
            DeleteNullptr(aReceiver);
 
            if (stop)
@@ -249,16 +265,25 @@ void cStateMachine::Action(void) {
 
         case eScanPat:
            if (PatScanner == nullptr) {
-              PatScanner = new cPatScanner(dev, PatData);
-              mSleep(100);
+              PatScanner = new cPatScanner(dev, PatData, demux, &event);
+              event.Wait(100);
               }
-           else if (!PatScanner->Active()) {
+           else if (PatScanner->Active())
+              event.Wait(100);
+           else {
               pmtstart = true;
               bool hasPAT = PatScanner->HasPAT();
               DeleteNullptr(PatScanner);
               if (stop or !hasPAT or !PatData.services.Count())
                  newState = eDetachReceiver;
               else {
+                 if (wSetup.DVBC_Network_PID == 0x10 and PatData.network_PID and PatData.network_PID != nitPid) {
+                    // rare: PAT points to a non-default NIT PID; restart NIT.
+                    dlog(4, "NIT on PID " + IntToStr(PatData.network_PID));
+                    StopScanner(NitScanner);
+                    nitPid = PatData.network_PID;
+                    NitScanner = new cNitScanner(dev, nitPid, nitData, dvbtype, demux, &event);
+                    }
                  dlog(4, "searching " + IntToStr(PatData.services.Count()) + " services");
                  newState = eScanPmt;
                  }
@@ -269,39 +294,42 @@ void cStateMachine::Action(void) {
         case eScanPmt:
            if (pmtstart) {
               pmtstart = false;
+              // PMT jobs at the same time: not more than free filters and PMTs.
+              // A job mostly waits for its PMT to repeat, so cores don't matter here.
+              // hardware: run up to 16 filters in parallel; up to 32 should be safe.
+              // software demux: as many as the receiver has PIDs left beside PAT, NIT and SDT.
+              int filters = demux ? demux->FreePids() : 16;
+              int limit   = std::max(1, std::min(filters, PatData.services.Count()));
+              if (PmtPool == nullptr)
+                 PmtPool = new cPmtPool(limit, &event);
+              PmtPool->SetLimit(limit);
+
+              // all PMT PIDs at once: the receiver is re-attached only once per transponder,
+              // instead of once per PMT. PIDs, which don't fit, use hardware section filters.
+              if (demux) {
+                 std::vector<int> pmtPids;
+                 for(int i = 0; i < PatData.services.Count(); i++)
+                    pmtPids.push_back(PatData.services[i].program_map_PID);
+                 demux->Reserve(pmtPids);
+                 }
+
               PmtScanners.Clear();
               PmtData.Clear();
+              PmtArena.Clear();
               for(int i = 0; i < PatData.services.Count(); i++) {
-                 TPmtData* d = new TPmtData;
+                 TPmtData* d = PmtArena.New();
                  d->program_map_PID = PatData.services[i].program_map_PID;
                  PmtData.Add(d);
-                 cPmtScanner* p = new cPmtScanner(dev, PmtData[i]);
+                 cPmtScanner* p = new cPmtScanner(dev, PmtData[i], demux);
                  PmtScanners.Add(p);
+                 PmtPool->Add(p);
                  }
               }
            else {
-              // run up to 16 filters in parallel; up to 32 should be safe.
-              int activePmts = 0;
-              int finished = 0;
-              for(int i = 0; i < PmtScanners.Count() and !stop; i++) {
-                 cPmtScanner* p = (cPmtScanner*) PmtScanners[i];
-                 if (p->Finished()) {
-                    finished++;
-                    continue;
-                    }
-                 if (p->Active()) {
-                    if (++activePmts > 16)
-                       break;
-                    }
-                 else {
-                    p->Start();
-                    if (++activePmts > 16)
-                       break;
-                    }
-                 }
-
-              if (finished < PmtScanners.Count())
+              if (PmtPool->Pending()) {
+                 event.Wait(100);
                  break;
+                 }
 
               for(int i=0; i<PmtScanners.Count(); i++)
                  DeleteNullptr(PmtScanners[i]);
@@ -316,21 +344,12 @@ void cStateMachine::Action(void) {
            break;
 
         case eGetTables: {
-           static int tm;
            if (tblstart) {
               tblstart = false;
               tm = time(0);
-              // some stupid cable providers use non-standard PID for NIT; sometimes called 'Setup-PID'.
-              if (wSetup.DVBC_Network_PID != 0x10)
-                 PatData.network_PID = wSetup.DVBC_Network_PID;
-              SdtData.original_network_id = 0;
-              NitData.OrbitalPos = initial->OrbitalPos;
-              NitData.West       = initial->West;
-              NitScanner = new cNitScanner(dev, PatData.network_PID, NitData, dvbtype);
-              SdtScanner = new cSdtScanner(dev, SdtData);
               }
            else {
-              if (!NitScanner->Active() and !SdtScanner->Active()) {
+              if (!NitScanner->Active() and (!SdtScanner or !SdtScanner->Active())) {
                  DeleteNullptr(NitScanner);
                  DeleteNullptr(SdtScanner);
 
@@ -339,6 +358,8 @@ void cStateMachine::Action(void) {
                  else
                     newState = eAddChannels;
                  }
+              else
+                 event.Wait(100);
               if (time(0) != tm) {
                  if (MenuScanning)
                     MenuScanning->SetProgress(lProgress);
@@ -349,6 +370,9 @@ void cStateMachine::Action(void) {
            break;
 
         case eAddChannels: {
+           tables.lock();
+           MergeTables(nitData, sdtData);
+
            if (wSetup.verbosity > 4) {
               for(int i = 0; i < PmtData.Count(); i++)
                  dlog(0, "PMT "                + IntToStr(PmtData[i]->program_map_PID) +
@@ -370,31 +394,31 @@ void cStateMachine::Action(void) {
                          ", Name = '"          + SdtData.services[i].Name + "'");
                  }
 
-              for(int i = 0; i < NitData.transport_streams.Count(); i++) {
-                 if (NitData.transport_streams[i]->reported)
+              for(auto ts:NitData.transport_streams.Lock()) {
+                 if (ts->reported)
                     continue;
-                 NitData.transport_streams[i]->reported = true;
-                 NitData.transport_streams[i]->PrintTransponder(s);
+                 ts->reported = true;
+                 ts->PrintTransponder(s);
                  std::string is_wrong;
-                 if (abs(NitData.transport_streams[i]->OrbitalPos - initial->OrbitalPos) > 5)
+                 if (abs(ts->OrbitalPos - initial->OrbitalPos) > 5)
                     is_wrong = "WRONG SATELLITE: ";
                  dlog(0, "NIT: " + is_wrong + "'" + s + "'" + 
-                         ", NID = "  + IntToStr(NitData.transport_streams[i]->NID)  +
-                         ", ONID = " + IntToStr(NitData.transport_streams[i]->ONID) +
-                         ", TID = "  + IntToStr(NitData.transport_streams[i]->TID));
-
-                 if (NitData.transport_streams[i]->Source == "T" and
-                     NitData.transport_streams[i]->DelSys == 1) {
-                    for(int c=0; c<NitData.transport_streams[i]->cells.Count(); c++) {
-                       for(int cf=0; cf<NitData.transport_streams[i]->cells[c].num_center_frequencies; cf++)
+                         ", NID = "  + IntToStr(ts->NID)  +
+                         ", ONID = " + IntToStr(ts->ONID) +
+                         ", TID = "  + IntToStr(ts->TID));
+
+                 if (ts->Source == "T" and
+                     ts->DelSys == 1) {
+                    for(int c=0; c<ts->cells.Count(); c++) {
+                       for(int cf=0; cf<ts->cells[c].num_center_frequencies; cf++)
                           dlog(0, "   center"   + IntToStr(c+1) +
-                                  " = "         + IntToStr(NitData.transport_streams[i]->cells[c].center_frequencies[cf]) +
-                                  " (cell_id "  + IntToStr(NitData.transport_streams[i]->cells[c].cell_id) + ")");
+                                  " = "         + IntToStr(ts->cells[c].center_frequencies[cf]) +
+                                  " (cell_id "  + IntToStr(ts->cells[c].cell_id) + ")");
 
-                       for(int tf=0; tf<NitData.transport_streams[i]->cells[c].num_transposers; tf++)
+                       for(int tf=0; tf<ts->cells[c].num_transposers; tf++)
                           dlog(0, "      transposer"     + IntToStr(tf+1) +
-                                  " = "                  + IntToStr(NitData.transport_streams[i]->cells[c].transposers[tf].transposer_frequency) +
-                                  " (cell_id_extension " + IntToStr(NitData.transport_streams[i]->cells[c].transposers[tf].cell_id_extension) + ")");
+                                  " = "                  + IntToStr(ts->cells[c].transposers[tf].transposer_frequency) +
+                                  " (cell_id_extension " + IntToStr(ts->cells[c].transposers[tf].cell_id_extension) + ")");
                        }
                     }
                  }
@@ -406,26 +430,27 @@ void cStateMachine::Action(void) {
            // SDT: transport_stream_id, original_network_id, [service_id, free_CA_mode]
            
            Transponder->TID = PatData.services[0].transport_stream_id;
-           if (SdtData.original_network_id) // update onid, if sdt found. 
-              Transponder->ONID = SdtData.original_network_id;
+           if (sdtData.original_network_id) // update onid, if sdt found. 
+              Transponder->ONID = sdtData.original_network_id;
 
-           for(int i = 0; i < NitData.transport_streams.Count(); i++) {
-              if ((NitData.transport_streams[i]->NID == Transponder->NID or
-                  NitData.transport_streams[i]->ONID == Transponder->ONID) and
-                  NitData.transport_streams[i]->TID == Transponder->TID) {
+           for(auto ts:NitData.transport_streams.Lock()) {
+              if ((ts->NID == Transponder->NID or
+                  ts->ONID == Transponder->ONID) and
+                  ts->TID == Transponder->TID) {
                  uint32_t f = Transponder->Frequency;
-                 uint32_t center_freq = NitData.transport_streams[i]->Frequency;
+                 uint32_t center_freq = ts->Frequency;
 
-                 Transponder->CopyTransponderData(NitData.transport_streams[i]);
+                 Transponder->CopyTransponderData(ts);
 
                  if ((center_freq < 100000000) or (center_freq > 858000000) or (abs((int)center_freq - (int)f) > 2000000))
                     Transponder->Frequency = f;
+                 TransponderChanged(Transponder);
                  break;
                  }
               }
 
            for(int i = 0; i < PmtData.Count(); i++) {
-              TChannel* n = new TChannel;
+              TChannel* n = ScanChannels.New();
               n->CopyTransponderData(Transponder);
               n->NID = Transponder->NID;
               n->ONID = Transponder->ONID;
@@ -443,21 +468,19 @@ void cStateMachine::Action(void) {
               n->PMT = PmtData[i]->program_map_PID;
 
               if (!n->VPID.PID and !n->APIDs.Count() and !n->DPIDs.Count()) {
-                 delete n;
+                 ScanChannels.Free(n);
                  continue;
                  }
 
-              for(int j = 0; j < SdtData.services.Count(); j++) {
-                 if (n->TID == SdtData.services[j].transport_stream_id and
-                     n->SID == SdtData.services[j].service_id) {
-                    n->Name         = SdtData.services[j].Name;
-                    n->Shortname    = SdtData.services[j].Shortname;
-                    n->Provider     = SdtData.services[j].Provider;
-                    n->free_CA_mode = SdtData.services[j].free_CA_mode;
-                    n->service_type = SdtData.services[j].service_type;
-                    n->ONID         = SdtData.services[j].original_network_id;
-                    break;
-                    }
+              int j = FindSdtService(n->TID, n->SID);
+              if (j >= 0) {
+                 const sdtservice& service = SdtData.services[j];
+                 n->Name         = service.Name;
+                 n->Shortname    = service.Shortname;
+                 n->Provider     = service.Provider;
+                 n->free_CA_mode = service.free_CA_mode;
+                 n->service_type = service.service_type;
+                 n->ONID         = service.original_network_id;
                  }
 
               if (n->service_type == SI_EXT::Teletext_service or
@@ -470,6 +493,7 @@ void cStateMachine::Action(void) {
                   n->service_type == SI_EXT::DVB_MHP_service or
                   n->service_type == SI_EXT::H264_AVC_codec_mosaic_service) {
                  dlog(5, "skip service " + IntToStr(n->SID) + " '" + n->Name + "' (no Audio/Video)");
+                 ScanChannels.Free(n);
                  continue;
                  }
 
@@ -478,10 +502,12 @@ void cStateMachine::Action(void) {
               if ((wSetup.scanflags & PMT_ALL) != PMT_ALL and n->service_type < 0xFFFF) {
                  if ((wSetup.scanflags & SCAN_SCRAMBLED) != SCAN_SCRAMBLED and n->free_CA_mode) {
                     dlog(5, "skip service " + IntToStr(n->SID) + " '" + n->Name + "' (encrypted)");
+                    ScanChannels.Free(n);
                     continue;
                     }
                  if ((wSetup.scanflags & SCAN_FTA) != SCAN_FTA and !n->free_CA_mode) {
                     dlog(5, "skip service " + IntToStr(n->SID) + " '" + n->Name + "' (FTA)");
+                    ScanChannels.Free(n);
                     continue;
                     }
 
@@ -501,6 +527,7 @@ void cStateMachine::Action(void) {
                         n->service_type == SI_EXT::H264_AVC_frame_compat_plano_stereoscopic_HD_NVOD_reference_service or
                         n->service_type == SI_EXT::HEVC_digital_television_service) {
                        dlog(5, "skip service " + IntToStr(n->SID) + " '" + n->Name + "' (tv)");
+                       ScanChannels.Free(n);
                        continue;
                        }
                     }
@@ -509,6 +536,7 @@ void cStateMachine::Action(void) {
                         n->service_type == SI_EXT::FM_radio_service or
                         n->service_type == SI_EXT::advanced_codec_digital_radio_sound_service) {
                        dlog(5, "skip service " + IntToStr(n->SID) + " '" + n->Name + "' (radio)");
+                       ScanChannels.Free(n);
                        continue;
                        }
                     }
@@ -521,91 +549,75 @@ void cStateMachine::Action(void) {
                  if (n->Name != "???") dlog(0, n->Name);
                  }
               NewChannels.Add(n);
+              if (n->Name == "???")
+                 AddUnnamedChannel(n); // SDT of a later transponder may name it.
               if (MenuScanning)
                  MenuScanning->SetChan(NewChannels.Count()); 
               }
 
-           for(int i = 0; i < NewChannels.Count(); i++) {
-              if (NewChannels[i]->Name != "???")
+           for(auto ts:NitData.transport_streams.Lock()) {
+              if (abs(ts->OrbitalPos - initial->OrbitalPos) > 5)
                  continue;
-              for(int j = 0; j < SdtData.services.Count(); j++) {
-                 if (NewChannels[i]->TID == SdtData.services[j].transport_stream_id and
-                   /*NewChannels[i]->NID == SdtData.services[j].original_network_id and*/
-                     NewChannels[i]->SID == SdtData.services[j].service_id) {
-                    NewChannels[i]->Name         = SdtData.services[j].Name;
-                    NewChannels[i]->Shortname    = SdtData.services[j].Shortname;
-                    NewChannels[i]->Provider     = SdtData.services[j].Provider;
-                    NewChannels[i]->free_CA_mode = SdtData.services[j].free_CA_mode;
-                    NewChannels[i]->Print(s);
-                    dlog(5, "Update: '" + s + "'");
-                    break;
-                    }
-                 }
-              }
-
-           for(int i = 0; i < NitData.transport_streams.Count(); i++) {
-              if (abs(NitData.transport_streams[i]->OrbitalPos - initial->OrbitalPos) > 5)
-                 continue;
-              if (!known_transponder(NitData.transport_streams[i], true)) {
-                 TChannel* tp = new TChannel;
-                 tp->CopyTransponderData(NitData.transport_streams[i]);
-                 tp->NID = NitData.transport_streams[i]->NID;
-                 tp->ONID = NitData.transport_streams[i]->ONID;
-                 tp->TID = NitData.transport_streams[i]->TID;
+              if (!known_transponder(ts, true)) {
+                 TChannel* tp = ScanChannels.New();
+                 tp->CopyTransponderData(ts);
+                 tp->NID = ts->NID;
+                 tp->ONID = ts->ONID;
+                 tp->TID = ts->TID;
                  tp->PrintTransponder(s);
                  dlog(4, "NewTransponders.Add: '" + s + "'" +
                          ", NID = " + IntToStr(tp->NID) +
                          ", TID = " + IntToStr(tp->TID));
-                 NewTransponders.Add(tp);
+                 AddNewTransponder(tp, dev->CardIndex());
                  }
 
-              if (NitData.transport_streams[i]->Source == "T" and NitData.transport_streams[i]->DelSys == 1) {
-                 for(int c = 0; c < NitData.transport_streams[i]->cells.Count(); c++) {
-                    for(int cf = 0; cf < NitData.transport_streams[i]->cells[c].num_center_frequencies; cf++) {
-                       TChannel* tp = new TChannel;
-                       tp->CopyTransponderData(NitData.transport_streams[i]);
-                       tp->NID = NitData.transport_streams[i]->NID;
-                       tp->TID = NitData.transport_streams[i]->TID;
-                       tp->Frequency = NitData.transport_streams[i]->cells[c].center_frequencies[cf];
+              if (ts->Source == "T" and ts->DelSys == 1) {
+                 for(int c = 0; c < ts->cells.Count(); c++) {
+                    for(int cf = 0; cf < ts->cells[c].num_center_frequencies; cf++) {
+                       TChannel* tp = ScanChannels.New();
+                       tp->CopyTransponderData(ts);
+                       tp->NID = ts->NID;
+                       tp->TID = ts->TID;
+                       tp->Frequency = ts->cells[c].center_frequencies[cf];
                        if (!known_transponder(tp, true)) {
                           tp->PrintTransponder(s);
                           dlog(4, "NewTransponders.Add: '" + s + "'" +
                                   ", NID = " + IntToStr(tp->NID) +
                                   ", TID = " + IntToStr(tp->TID));
-                          NewTransponders.Add(tp);
+                          AddNewTransponder(tp, dev->CardIndex());
                           }
                        else
-                          delete tp;
+                          ScanChannels.Free(tp);
                        }
-                    for(int tf = 0; tf < NitData.transport_streams[i]->cells[c].num_transposers; tf++) {
-                       TChannel* tp = new TChannel;
-                       tp->CopyTransponderData(NitData.transport_streams[i]);
-                       tp->NID = NitData.transport_streams[i]->NID;
-                       tp->TID = NitData.transport_streams[i]->TID;
-                       tp->Frequency = NitData.transport_streams[i]->cells[c].transposers[tf].transposer_frequency;
+                    for(int tf = 0; tf < ts->cells[c].num_transposers; tf++) {
+                       TChannel* tp = ScanChannels.New();
+                       tp->CopyTransponderData(ts);
+                       tp->NID = ts->NID;
+                       tp->TID = ts->TID;
+                       tp->Frequency = ts->cells[c].transposers[tf].transposer_frequency;
                        if (!known_transponder(tp, true)) {
                           tp->PrintTransponder(s);
                           dlog(4, "NewTransponders.Add: '" + s + "'" +
                                   ", NID = " + IntToStr(tp->NID) +
                                   ", TID = " + IntToStr(tp->TID));
-                          NewTransponders.Add(tp);
+                          AddNewTransponder(tp, dev->CardIndex());
                           }
                        else
-                          delete tp;
+                          ScanChannels.Free(tp);
                        }
                     }
                  }
               }
 
-           for(int i = 0; i < NitData.cell_frequency_links.Count(); i++) {
+           for(int i = 0; i < nitData.cell_frequency_links.Count(); i++) {
               TChannel t;
 
               if (wSetup.verbosity > 5)
-                 dlog(0, "NIT: cell_id "   + IntToStr  (NitData.cell_frequency_links[i].cell_id) +
-                         ", frequency "    + FloatToStr(NitData.cell_frequency_links[i].frequency/1e6, 7, 3, false) +
-                         "MHz network_id " + IntToStr  (NitData.cell_frequency_links[i].network_id));
+                 dlog(0, "NIT: cell_id "   + IntToStr  (nitData.cell_frequency_links[i].cell_id) +
+                         ", frequency "    + FloatToStr(nitData.cell_frequency_links[i].frequency/1e6, 7, 3, false) +
+                         "MHz network_id " + IntToStr  (nitData.cell_frequency_links[i].network_id));
               t.Source       = 'T';
-              t.Frequency    = NitData.cell_frequency_links[i].frequency;
+              t.Frequency    = nitData.cell_frequency_links[i].frequency;
               t.Bandwidth    = t.Frequency <= 226500000 ? 7 : 8;
               t.Inversion    = 999;
               t.FEC          = 999;
@@ -617,72 +629,73 @@ void cStateMachine::Action(void) {
               t.DelSys       = 0;
 
               if (!known_transponder(&t, true)) {
-                 TChannel* n = new TChannel;
+                 TChannel* n = ScanChannels.New();
                  n->CopyTransponderData(&t);
                  n->PrintTransponder(s);
                  dlog(4, "NewTransponders.Add: '" + s + "'" +
                          ", NID = " + IntToStr(n->NID) +
                          ", TID = " + IntToStr(n->TID));
-                 NewTransponders.Add(n);
+                 AddNewTransponder(n, dev->CardIndex());
                  }
 
               t.DelSys = 1;
               if (!known_transponder(&t, true)) {
-                 TChannel* n = new TChannel;
+                 TChannel* n = ScanChannels.New();
                  n->CopyTransponderData(&t);
                  n->PrintTransponder(s);
                  dlog(4, "NewTransponders.Add: '" + s + "'" +
                          ", NID = " + IntToStr(n->NID) +
                          ", TID = " + IntToStr(n->TID));
-                 NewTransponders.Add(n);
+                 AddNewTransponder(n, dev->CardIndex());
                  }
 
-              for(int j = 0; j < NitData.cell_frequency_links[i].subcellcount; j++) {
+              for(size_t j = 0; j < nitData.cell_frequency_links[i].subcells.size(); j++) {
                  dlog(5, "NIT:    cell_id_extension " +
-                         IntToStr(NitData.cell_frequency_links[i].subcells[j].cell_id_extension) +
+                         IntToStr(nitData.cell_frequency_links[i].subcells[j].cell_id_extension) +
                          ", frequency " +
-                         FloatToStr(NitData.cell_frequency_links[i].subcells[j].transposer_frequency/1e6, 7, 3, false) +
+                         FloatToStr(nitData.cell_frequency_links[i].subcells[j].transposer_frequency/1e6, 7, 3, false) +
                          "MHz");
-                 t.Frequency = NitData.cell_frequency_links[i].subcells[j].transposer_frequency;
+                 t.Frequency = nitData.cell_frequency_links[i].subcells[j].transposer_frequency;
                  t.Bandwidth = t.Frequency <= 226500000 ? 7 : 8;
                  t.DelSys    = 0;
                  
                  if (!known_transponder(&t, true)) {
-                    TChannel* tp = new TChannel;
+                    TChannel* tp = ScanChannels.New();
                     tp->CopyTransponderData(&t);
                     tp->PrintTransponder(s);
                     dlog(4, "NewTransponders.Add: '" + s + "'" +
                             ", NID = " + IntToStr(tp->NID) +
                             ", TID = " + IntToStr(tp->TID));
-                    NewTransponders.Add(tp);
+                    AddNewTransponder(tp, dev->CardIndex());
                     }
                  
                  t.DelSys = 1;
                  if (!known_transponder(&t, true)) {
-                    TChannel* tp = new TChannel;
+                    TChannel* tp = ScanChannels.New();
                     tp->CopyTransponderData(&t);
                     tp->PrintTransponder(s);
                     dlog(4, "NewTransponders.Add: '" + s + "'" +
                             ", NID = " + IntToStr(tp->NID) +
                             ", TID = " + IntToStr(tp->TID));
-                    NewTransponders.Add(tp);
+                    AddNewTransponder(tp, dev->CardIndex());
                     }
                  }
               }
 
-           for(int i = 0; i < NewChannels.Count(); i++) {
-              if (NewChannels[i]->LCN == -1 and GetLCN(NewChannels[i]) and wSetup.verbosity > 4) {
+           // channels without LCN are retried, the NIT of a later transponder may list them.
+           for(auto c:NewChannels.Lock()) {
+              if (c->LCN == -1 and GetLCN(c) and wSetup.verbosity > 4) {
                  std::string s;
 
-                 s = "assigned LCN: " + FrontFill(IntToStr(NewChannels[i]->LCN),4);
+                 s = "assigned LCN: " + FrontFill(IntToStr(c->LCN),4);
 
-                 if (NewChannels[i]->LCN_minor > -1)
-                    s += "." + IntToStr(NewChannels[i]->LCN_minor);
+                 if (c->LCN_minor > -1)
+                    s += "." + IntToStr(c->LCN_minor);
 
                  s += " = (SID:ONID:TID) " +
-                    IntToStr(NewChannels[i]->SID ) + ":" +
-                    IntToStr(NewChannels[i]->ONID) + ":" +
-                    IntToStr(NewChannels[i]->TID );
+                    IntToStr(c->SID ) + ":" +
+                    IntToStr(c->ONID) + ":" +
+                    IntToStr(c->TID );
 
                  dlog(5, s);
                  }
@@ -691,11 +704,9 @@ void cStateMachine::Action(void) {
            // delete data from current tp
            PatData.network_PID = 0x10;
            PatData.services.Clear();
-           for(int i=0; i<PmtData.Count(); i++)
-              delete PmtData[i];
            PmtData.Clear();
-           NitData.frequency_list.Clear();
-           NitData.cell_frequency_links.Clear();
+           PmtArena.Clear();
+           tables.unlock();
 
            newState = eDetachReceiver;
            }
@@ -710,5 +721,24 @@ void cStateMachine::Action(void) {
      }
   dlog(0, "DIRECT_EXIT");
   DIRECT_EXIT:
+  for(int i = 0; i < PmtScanners.Count(); i++)
+     PmtScanners[i]->Stop();
+  if (PmtPool) {
+     dlog(4, "PMT pool: " + IntToStr(PmtPool->Size()) + " threads for " + IntToStr(PmtPool->Jobs()) + " PMTs");
+     PmtPool->Clear();
+     DeleteNullptr(PmtPool);
+     }
+  for(int i = 0; i < PmtScanners.Count(); i++)
+     DeleteNullptr(PmtScanners[i]);
+  PmtScanners.Clear();
+  StopScanner(PatScanner);
+  StopScanner(NitScanner);
+  StopScanner(SdtScanner);
+  ClearTables(nitData, sdtData);
+  if (aReceiver) {
+     dev->Detach(aReceiver);
+     DeleteNullptr(aReceiver);
+     }
+  if (done) done->Signal();
   Cancel();
 }
@@ -4,6 +4,7 @@
  ******************************************************************************/
 #pragma once
 #include <repfunc.h>
+#include "common.h" // cScanEvent
 
 /*******************************************************************************
  * forward decls
@@ -41,11 +42,13 @@ private:
   bool        stop;
   bool        useNit;
   void*       parent;
+  cScanEvent  event;      // signaled by the section scanners and DoStop()
+  cScanEvent* done;       // signaled on exit, may be nullptr
 protected:
   virtual void Action(void);
   virtual void Report(eState State);
 public:
-  cStateMachine(cDevice* Dev, TChannel* InitialTransponder, bool UseNit, void* Parent);
+  cStateMachine(cDevice* Dev, TChannel* InitialTransponder, bool UseNit, void* Parent, cScanEvent* Done = nullptr);
   virtual ~cStateMachine(void);
   void DoStop(void);
   bool Active(void);
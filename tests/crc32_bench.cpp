@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>         // printf()
+#include <libsi/util.h>   // SI::CRC32
+#include "../crc32.h"     // Crc32()
+
+/*******************************************************************************
+ * CRC-32/MPEG-2 throughput of libsi's byte by byte SI::CRC32::crc32() versus
+ * the slice-by-8 Crc32(), on sections of one TS packet, 1 KiB (the maximum of
+ * PAT, PMT, NIT and SDT) and 4 KiB (EIT and other private sections).
+ ******************************************************************************/
+
+static const size_t Bytes = 256 * 1024 * 1024;   // per size and implementation
+
+static volatile uint32_t sink;
+
+template<class F> static double Measure(size_t Size, F Func) {
+  size_t rounds = Bytes / Size;
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < rounds; i++)
+     sink += Func();
+  std::chrono::duration<double> s = std::chrono::steady_clock::now() - start;
+  return rounds * Size / s.count() / 1e6;
+}
+
+int main(void) {
+  std::mt19937 random(0x04C11DB7);
+  std::vector<unsigned char> data(4096);
+  for(auto& b:data)
+     b = random();
+
+  printf("CRC-32/MPEG-2, MB/s:\n");
+  printf("  size    SI::CRC32     Crc32()\n");
+  for(size_t size : { 188, 1024, 4096 }) {
+     const unsigned char* p = data.data();
+     double libsi = Measure(size, [p, size]{ return SI::CRC32::crc32((const char*) p, size, 0xFFFFFFFF); });
+     double table = Measure(size, [p, size]{ return Crc32(p, size); });
+     printf("  %4zu  %11.1f %11.1f\n", size, libsi, table);
+     }
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <vector>
+#include <random>
+#include <cstdio>         // printf()
+#include <libsi/util.h>   // SI::CRC32
+#include "../crc32.h"     // Crc32(), SectionCrcValid()
+
+/*******************************************************************************
+ * Crc32() and SectionCrcValid() have to give the same results as libsi's
+ * byte by byte SI::CRC32, on random data of any length and alignment and on
+ * PAT, PMT, NIT and SDT sections.
+ ******************************************************************************/
+
+static int failed = 0;
+
+static void Check(bool Ok, const char* What, size_t Length) {
+  if (!Ok) {
+     printf("FAILED: %s, length %zu\n", What, Length);
+     failed++;
+     }
+}
+
+static uint32_t LibSi(const unsigned char* Data, size_t Length, uint32_t Crc = 0xFFFFFFFF) {
+  return SI::CRC32::crc32((const char*) Data, Length, Crc);
+}
+
+// a section with section_syntax_indicator: header, Payload and CRC_32.
+static std::vector<unsigned char> Section(int TableId, int Extension, const std::vector<unsigned char>& Payload) {
+  size_t length = 5 + Payload.size() + 4;
+  std::vector<unsigned char> s = {
+     (unsigned char) TableId,
+     (unsigned char) (0xB0 | length >> 8), (unsigned char) length,
+     (unsigned char) (Extension >> 8), (unsigned char) Extension,
+     0xC1,                               // version 0, current
+     0x00, 0x00                          // section 0 of 0
+     };
+  s.insert(s.end(), Payload.begin(), Payload.end());
+  uint32_t crc = LibSi(s.data(), s.size());
+  for(int shift = 24; shift >= 0; shift -= 8)
+     s.push_back(crc >> shift);
+  return s;
+}
+
+int main(void) {
+  std::mt19937 random(0x04C11DB7);
+  std::vector<unsigned char> data(4096 + 8);
+  for(auto& b:data)
+     b = random();
+
+  // every length up to a full section and every alignment of the slice-by-8 loop.
+  for(size_t offset = 0; offset < 8; offset++)
+     for(size_t length = 0; length <= 4096; length++)
+        Check(Crc32(data.data() + offset, length) == LibSi(data.data() + offset, length), "random data", length);
+
+  // continued CRCs, ie. other initial values.
+  for(int i = 0; i < 10000; i++) {
+     size_t length = random() % 4096;
+     uint32_t init = random();
+     Check(Crc32(data.data(), length, init) == LibSi(data.data(), length, init), "initial value", length);
+     }
+
+  std::vector<std::vector<unsigned char>> sections = {
+     Section(0x00, 0x0401, { 0x00, 0x00, 0xE0, 0x10,                    // PAT: NIT on PID 0x10,
+                             0x00, 0x1C, 0xE0, 0x64, 0x00, 0x1D, 0xE0, 0x65 }), // programs 28 and 29
+     Section(0x02, 0x001C, { 0xE0, 0xFF, 0xF0, 0x00,                    // PMT: PCR PID 0xFF,
+                             0x1B, 0xE0, 0xFF, 0xF0, 0x00,              // H.264 video,
+                             0x03, 0xE1, 0x00, 0xF0, 0x06, 0x0A, 0x04, 'd', 'e', 'u', 0x01 }), // mpeg audio 'deu'
+     Section(0x40, 0x0001, { 0xF0, 0x00, 0xF0, 0x0E,                    // NIT: one transport stream,
+                             0x04, 0x01, 0x00, 0x01, 0xF0, 0x08,        // TID 0x401, ONID 1,
+                             0x41, 0x06, 0x00, 0x1C, 0x01, 0x00, 0x1D, 0x01 }), // service list descriptor
+     Section(0x42, 0x0401, { 0x00, 0x01, 0xFF,                          // SDT: ONID 1,
+                             0x00, 0x1C, 0xFC, 0x80, 0x0A,              // service 28,
+                             0x48, 0x08, 0x01, 0x02, 'A', 'B', 0x03, 'T', 'V', '1' }), // service descriptor
+     };
+
+  for(auto& s:sections) {
+     Check(Crc32(s.data(), s.size()) == 0, "section, crc over all", s.size());
+     Check(SectionCrcValid(s.data(), s.size()), "valid section", s.size());
+     Check(SI::CRC32::isValid((const char*) s.data(), s.size()), "libsi, valid section", s.size());
+
+     std::vector<unsigned char> padded(s);
+     padded.resize(padded.size() + 100, 0xFF);                           // stuffing after the section
+     Check(SectionCrcValid(padded.data(), padded.size()), "section with stuffing", s.size());
+
+     for(size_t i = 0; i < s.size() * 8; i++) {
+        std::vector<unsigned char> broken(s);
+        broken[i / 8] ^= 1 << (i % 8);
+        bool libsi = SI::CRC32::isValid((const char*) broken.data(), broken.size());
+        Check(!libsi, "libsi, broken section", s.size());
+        // header bits may make the section length invalid: then it's rejected anyway.
+        Check(SectionCrcValid(broken.data(), broken.size()) == libsi, "broken section", s.size());
+        }
+     Check(!SectionCrcValid(s.data(), s.size() - 1), "truncated section", s.size());
+     }
+
+  printf("crc32_check: %s\n", failed ? "FAILED" : "passed");
+  return failed ? 1 : 0;
+}
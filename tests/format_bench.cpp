@@ -0,0 +1,368 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <string>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>       // printf()
+#include <repfunc.h>    // IntToStr(), FloatToStr()
+#include "../format.h"  // AppendInt(), AppendHex(), AppendParam(), AppendFloat()
+
+/*******************************************************************************
+ * channel lines and transponder strings of 10000 synthetic DVB-S2 and DVB-C
+ * channels: the stringstream, IntToStr() and FloatToStr() code of
+ * TChannel::Print() and PrintTransponder() before format.h, versus the
+ * Append*() code of today, writing into one reused string.
+ * The channel is a plain copy of TChannel's fields, as TChannel needs vdr.
+ ******************************************************************************/
+
+static const int Channels = 10000;
+static const int Rounds   = 20;
+
+struct TPid {
+  int PID;
+  int Type;
+  std::string Lang;
+};
+
+struct TBenchChannel {
+  std::string Name, Shortname, Provider, Source;
+  int Frequency, Symbolrate, FEC, Inversion, Modulation, Pilot, Rolloff, StreamId, DelSys;
+  char Polarization;
+  int VPID, VType, PCR, TPID, SID, ONID, TID, RID;
+  std::vector<TPid> APIDs, DPIDs;
+  std::vector<int> CAIDs;
+};
+
+static std::vector<TBenchChannel> Synthetic(void) {
+  std::vector<TBenchChannel> channels(Channels);
+  for(int i = 0; i < Channels; i++) {
+     TBenchChannel& c = channels[i];
+     bool sat = i % 2;
+     c.Name         = "Channel " + std::to_string(i) + " HD";
+     c.Shortname    = (i % 3) ? "" : "Ch" + std::to_string(i);
+     c.Provider     = "Provider " + std::to_string(i % 40);
+     c.Source       = sat ? "S19.2E" : "C";
+     c.Frequency    = sat ? 10744 + i % 1000 : 113000 + 8000 * (i % 100);
+     c.Symbolrate   = sat ? 22000 : 6900;
+     c.FEC          = sat ? 56 : 999;
+     c.Inversion    = sat ? 999 : 0;
+     c.Modulation   = sat ? 5 : 256;
+     c.Pilot        = 0;
+     c.Rolloff      = 35;
+     c.StreamId     = 999;
+     c.DelSys       = sat ? 1 : 999;
+     c.Polarization = sat ? ((i % 4) > 1 ? 'H' : 'V') : 0;
+     c.VPID         = 5100 + i % 3000;
+     c.VType        = 27;
+     c.PCR          = c.VPID + (i % 2);
+     c.TPID         = (i % 5) ? 0 : 2304;
+     c.APIDs        = { { 5102, 3, "deu" }, { 5103, 3, "eng" } };
+     c.DPIDs        = { { 5106, 106, "deu" } };
+     if (i % 4 == 0)
+        c.CAIDs     = { 0x1702, 0x1833, 0x09C4 };
+     c.SID          = 61200 + i % 1000;
+     c.ONID         = sat ? 1 : 61441;
+     c.TID          = 1000 + i % 500;
+     c.RID          = 0;
+     }
+  return channels;
+}
+
+/*******************************************************************************
+ * before format.h
+ ******************************************************************************/
+
+static void OldParams(const TBenchChannel& c, std::string& s) {
+  s.clear();
+  s.reserve(18 * 4);
+  switch(c.Source[0]) {
+     case 'C':
+        if (c.FEC != 999)           s += "C" + IntToStr(c.FEC);
+        if (c.Inversion != 999)     s += "I" + IntToStr(c.Inversion);
+        if (c.Modulation != 999)    s += "M" + IntToStr(c.Modulation);
+        break;
+     case 'S':
+        if (c.Polarization)         s += c.Polarization;
+        if (c.FEC != 999)           s += "C" + IntToStr(c.FEC);
+        if (c.Inversion != 999)     s += "I" + IntToStr(c.Inversion);
+        if (c.Modulation != 999)    s += "M" + IntToStr(c.Modulation);
+        if (c.DelSys) {
+           if (c.Pilot != 999)      s += "N" + IntToStr(c.Pilot);
+           if (c.Rolloff != 999)    s += "O" + IntToStr(c.Rolloff);
+           if (c.StreamId != 999)   s += "P" + IntToStr(c.StreamId);
+           }
+        if (c.DelSys != 999)        s += "S" + IntToStr(c.DelSys);
+        break;
+     default:;
+     }
+}
+
+static void OldPrintTransponder(const TBenchChannel& c, std::string& dest) {
+  std::stringstream ss;
+  std::string params;
+  OldParams(c, params);
+  int i = c.Frequency;
+  char source = c.Source[0];
+
+  if (i < 1000)    i *= 1000;
+  if (i > 999999)  i /= 1000;
+
+  ss << source;
+
+  if (c.DelSys == 1)
+     ss << "2 ";
+  else
+     ss << "  ";
+
+  ss << FloatToStr((source == 'S')?i:i/1000.0, 8, 2, false) << " MHz";
+
+  if ((source == 'C') or (source == 'S')) {
+     i = c.Symbolrate;
+     if (i < 1000)    i *= 1000;
+     if (i > 999999)  i /= 1000;
+     ss << " SR " << IntToStr(i) << ' ' << params;
+     }
+
+  dest = std::move(ss.str());
+}
+
+static void OldPids(std::stringstream& ss, const std::vector<TPid>& pids, char First) {
+  for(size_t i=0; i<pids.size(); ++i) {
+     if (i == 0)
+        ss << First;
+     else
+        ss << ',';
+     ss << IntToStr(pids[i].PID);
+     if (not pids[i].Lang.empty())
+        ss << '=' << pids[i].Lang;
+     if (pids[i].Type)
+        ss << '@' << IntToStr(pids[i].Type);
+     }
+}
+
+static void OldPrint(const TBenchChannel& c, std::string& dest) {
+  std::stringstream ss;
+  std::string params;
+  OldParams(c, params);
+
+  if (c.Name.empty())
+     ss << "NULL";
+  else
+     ss << c.Name;
+
+  if (not c.Shortname.empty())
+     ss <<  ',' << c.Shortname;
+
+  if (not c.Provider.empty())
+     ss <<  ';' << c.Provider;
+
+  ss << ':' << IntToStr(c.Frequency)
+     << ':' << params
+     << ':' << c.Source
+     << ':' << IntToStr(c.Symbolrate)
+     << ':' << IntToStr(c.VPID);
+
+  if (c.PCR and (c.PCR != c.VPID))
+     ss << '+' << IntToStr(c.PCR);
+
+  if (c.VType)
+     ss << '=' << IntToStr(c.VType);
+
+  if (c.APIDs.size())
+     OldPids(ss, c.APIDs, ':');
+  else
+     ss << ":0";
+
+  OldPids(ss, c.DPIDs, ';');
+  ss << ':' << IntToStr(c.TPID);
+  if (c.CAIDs.size()) {
+     for(size_t i=0; i<c.CAIDs.size(); ++i) {
+        if (i == 0)
+           ss << ':';
+        else
+           ss << ',';
+        ss << std::nouppercase << std::hex << c.CAIDs[i] << std::dec;
+        }
+     }
+  else
+     ss << ":0";
+  ss << ':' << IntToStr(c.SID)
+     << ':' << IntToStr(c.ONID)
+     << ':' << IntToStr(c.TID)
+     << ':' << IntToStr(c.RID);
+
+  dest = std::move(ss.str());
+}
+
+/*******************************************************************************
+ * format.h
+ ******************************************************************************/
+
+static void NewParams(const TBenchChannel& c, std::string& s) {
+  switch(c.Source[0]) {
+     case 'C':
+        if (c.FEC != 999)               AppendParam(s, 'C', c.FEC);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
+        break;
+     case 'S':
+        if (c.Polarization)             s += c.Polarization;
+        if (c.FEC != 999)               AppendParam(s, 'C', c.FEC);
+        if (c.Inversion != 999)         AppendParam(s, 'I', c.Inversion);
+        if (c.Modulation != 999)        AppendParam(s, 'M', c.Modulation);
+        if (c.DelSys) {
+           if (c.Pilot != 999)          AppendParam(s, 'N', c.Pilot);
+           if (c.Rolloff != 999)        AppendParam(s, 'O', c.Rolloff);
+           if (c.StreamId != 999)       AppendParam(s, 'P', c.StreamId);
+           }
+        if (c.DelSys != 999)            AppendParam(s, 'S', c.DelSys);
+        break;
+     default:;
+     }
+}
+
+static void NewPrintTransponder(const TBenchChannel& c, std::string& dest) {
+  int i = c.Frequency;
+  char source = c.Source[0];
+
+  if (i < 1000)    i *= 1000;
+  if (i > 999999)  i /= 1000;
+
+  dest.clear();
+  dest += source;
+
+  if (c.DelSys == 1)
+     dest += "2 ";
+  else
+     dest += "  ";
+
+  AppendFloat(dest, (source == 'S')?i:i/1000.0, 8, 2);
+  dest += " MHz";
+
+  if ((source == 'C') or (source == 'S')) {
+     i = c.Symbolrate;
+     if (i < 1000)    i *= 1000;
+     if (i > 999999)  i /= 1000;
+     dest += " SR ";
+     AppendInt(dest, i);
+     dest += ' ';
+     NewParams(c, dest);
+     }
+}
+
+static void NewPids(std::string& dest, const std::vector<TPid>& pids, char First) {
+  for(size_t i=0; i<pids.size(); ++i) {
+     dest += (i == 0) ? First : ',';
+     AppendInt(dest, pids[i].PID);
+     if (not pids[i].Lang.empty()) {
+        dest += '=';
+        dest += pids[i].Lang;
+        }
+     if (pids[i].Type)
+        AppendParam(dest, '@', pids[i].Type);
+     }
+}
+
+static void NewPrint(const TBenchChannel& c, std::string& dest) {
+  dest.clear();
+
+  if (c.Name.empty())
+     dest += "NULL";
+  else
+     dest += c.Name;
+
+  if (not c.Shortname.empty()) {
+     dest += ',';
+     dest += c.Shortname;
+     }
+
+  if (not c.Provider.empty()) {
+     dest += ';';
+     dest += c.Provider;
+     }
+
+  AppendParam(dest, ':', c.Frequency);
+  dest += ':';
+  NewParams(c, dest);
+  dest += ':';
+  dest += c.Source;
+  AppendParam(dest, ':', c.Symbolrate);
+  AppendParam(dest, ':', c.VPID);
+
+  if (c.PCR and (c.PCR != c.VPID))
+     AppendParam(dest, '+', c.PCR);
+
+  if (c.VType)
+     AppendParam(dest, '=', c.VType);
+
+  if (c.APIDs.size())
+     NewPids(dest, c.APIDs, ':');
+  else
+     dest += ":0";
+
+  NewPids(dest, c.DPIDs, ';');
+  AppendParam(dest, ':', c.TPID);
+
+  if (c.CAIDs.size()) {
+     for(size_t i=0; i<c.CAIDs.size(); ++i) {
+        dest += (i == 0) ? ':' : ',';
+        AppendHex(dest, c.CAIDs[i]);
+        }
+     }
+  else
+     dest += ":0";
+
+  AppendParam(dest, ':', c.SID);
+  AppendParam(dest, ':', c.ONID);
+  AppendParam(dest, ':', c.TID);
+  AppendParam(dest, ':', c.RID);
+}
+
+static volatile size_t sink;
+
+// ms per 10000 channels, mean of Rounds.
+template<class F> static double Measure(const std::vector<TBenchChannel>& Channels, F Func) {
+  std::string s;
+  auto start = std::chrono::steady_clock::now();
+  for(int r = 0; r < Rounds; r++)
+     for(auto& c:Channels) {
+        Func(c, s);
+        sink += s.size();
+        }
+  std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+  return ms.count() / Rounds;
+}
+
+int main(void) {
+  std::vector<TBenchChannel> channels = Synthetic();
+
+  std::string a, b;
+  for(auto& c:channels) {
+     OldPrint(c, a);
+     NewPrint(c, b);
+     if (a != b) {
+        printf("output differs: '%s' vs. '%s'\n", a.c_str(), b.c_str());
+        return 1;
+        }
+     OldPrintTransponder(c, a);
+     NewPrintTransponder(c, b);
+     if (a != b) {
+        printf("output differs: '%s' vs. '%s'\n", a.c_str(), b.c_str());
+        return 1;
+        }
+     }
+
+  double oldPrint = Measure(channels, OldPrint);
+  double newPrint = Measure(channels, NewPrint);
+  double oldTp    = Measure(channels, OldPrintTransponder);
+  double newTp    = Measure(channels, NewPrintTransponder);
+
+  printf("%d channels, ms, mean of %d rounds:\n", Channels, Rounds);
+  printf("                      stringstream    Append*()\n");
+  printf("  Print()            %12.2f %12.2f\n", oldPrint, newPrint);
+  printf("  PrintTransponder() %12.2f %12.2f\n", oldTp, newTp);
+  return 0;
+}
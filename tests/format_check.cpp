@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <string>
+#include <sstream>
+#include <climits>      // INT_MIN, INT_MAX
+#include <cstdio>       // printf()
+#include <repfunc.h>    // IntToStr(), FloatToStr()
+#include "../format.h"  // AppendInt(), AppendHex(), AppendParam(), AppendFloat()
+
+/*******************************************************************************
+ * the channel line formatters have to give byte identical output to the
+ * IntToStr(), std::hex and FloatToStr() calls, which they replaced in
+ * TChannel::Print(), PrintTransponder() and Params().
+ ******************************************************************************/
+
+static int failed = 0;
+
+static void Check(const std::string& New, const std::string& Old) {
+  if (New != Old and failed++ < 10)
+     printf("FAILED: '%s', expected '%s'\n", New.c_str(), Old.c_str());
+}
+
+int main(void) {
+  std::string s;
+
+  // PIDs, parameters, symbol rates and frequencies in Hz, kHz and MHz.
+  int ints[] = { 0, 1, -1, 9, 10, 99, 100, 999, 1000, 8191, 27500, 100000, 474000,
+                 -2147483647, INT_MIN, INT_MAX };
+  for(auto n:ints) {
+     s.clear();
+     AppendInt(s, n);
+     Check(s, IntToStr(n));
+     }
+  for(int n = -100000; n <= 1000000; n++) {
+     s.clear();
+     AppendInt(s, n);
+     Check(s, IntToStr(n));
+     }
+
+  // CAIDs
+  for(unsigned n = 0; n <= 0xFFFF; n++) {
+     std::stringstream ss;
+     ss << std::nouppercase << std::hex << n;
+     s.clear();
+     AppendHex(s, n);
+     Check(s, ss.str());
+     }
+  for(unsigned n:{ 0x10000U, 0xABCDEF01U, 0xFFFFFFFFU }) {
+     std::stringstream ss;
+     ss << std::nouppercase << std::hex << n;
+     s.clear();
+     AppendHex(s, n);
+     Check(s, ss.str());
+     }
+
+  // a DVB-T2 parameter string, appended to the same string.
+  s = "B8C23D0G19";
+  AppendParam(s, 'I', 999);
+  AppendParam(s, 'M', 64);
+  AppendParam(s, 'P', 0);
+  AppendParam(s, 'S', 1);
+  Check(s, "B8C23D0G19" + std::string("I") + IntToStr(999) + "M" + IntToStr(64) + "P" + IntToStr(0) + "S" + IntToStr(1));
+
+  // PrintTransponder(): MHz of cable and terrestrial (kHz / 1000.0) and satellite (MHz) transponders.
+  for(int i = 0; i <= 999999; i++) {
+     s.clear();
+     AppendFloat(s, i / 1000.0, 8, 2);
+     Check(s, FloatToStr(i / 1000.0, 8, 2, false));
+     }
+  for(int i = 0; i <= 99999; i++) {
+     s.clear();
+     AppendFloat(s, i, 8, 2);
+     Check(s, FloatToStr(i, 8, 2, false));
+     }
+
+  printf("format_check: %s\n", failed ? "FAILED" : "passed");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>        // std::min()
+#include <thread>           // std::this_thread::yield()
+#include <cstdio>           // printf()
+#include <repfunc.h>        // ThreadBase
+#include "../scanevent.h"   // cScanEvent
+#include "../pmtpool.h"     // cPmtJob, cPmtPool
+
+/*******************************************************************************
+ * the PMT jobs of one transponder: one thread per job, up to 16 at once (as
+ * cPmtScanner before cPmtPool), versus cPmtPool with the limits of hardware
+ * section filters and of the software demux.
+ * The jobs don't read a PMT, so the times are the threading overhead only.
+ ******************************************************************************/
+
+static const int Services     = 150;  // PAT entries of a large satellite transponder
+static const int Transponders = 100;
+static const int Filters      = 16;   // hardware section filters
+static const int ReceiverPids = 61;   // MAXRECEIVEPIDS, beside PAT, NIT and SDT
+
+static std::atomic<unsigned> sink(0);
+
+// a cPmtScanner thread before cPmtPool, without the PMT.
+class cThreadJob : public ThreadBase {
+private:
+  cScanEvent* done;
+protected:
+  virtual void Action(void) {
+     sink++;
+     done->Signal();
+     }
+public:
+  cThreadJob(cScanEvent* Done) : done(Done) {}
+  ~cThreadJob() {
+     while(Running())
+        std::this_thread::yield();
+     }
+};
+
+// a cPmtScanner job, without the PMT.
+class cNoPmt : public cPmtJob {
+public:
+  virtual void Scan(unsigned char* Buffer, int Size) {
+     sink += Buffer[Size - 1];
+     }
+};
+
+static void ThreadPerJob(void) {
+  cScanEvent done;
+  for(int first = 0; first < Services; first += Filters) {
+     std::vector<cThreadJob*> threads;
+     for(int i = first; i < std::min(first + Filters, Services); i++) {
+        threads.push_back(new cThreadJob(&done));
+        threads.back()->Start();
+        }
+     for(auto t:threads)
+        delete t;
+     }
+}
+
+static void Pool(cPmtPool& Pool, cScanEvent& Event) {
+  std::vector<cNoPmt> jobs(Services);
+  for(auto& j:jobs)
+     Pool.Add(&j);
+  while(Pool.Pending())
+     Event.Wait(100);
+}
+
+template<class F> static double Measure(F Func) {
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < Transponders; i++)
+     Func();
+  std::chrono::duration<double, std::micro> us = std::chrono::steady_clock::now() - start;
+  return us.count() / Transponders;
+}
+
+int main(void) {
+  cScanEvent hwEvent, swEvent;
+  cPmtPool hw(Filters, &hwEvent);
+  cPmtPool sw(ReceiverPids, &swEvent);
+
+  double before = Measure(ThreadPerJob);
+  double filters = Measure([&]{ Pool(hw, hwEvent); });
+  double pids    = Measure([&]{ Pool(sw, swEvent); });
+
+  printf("%d PMT jobs per transponder, mean of %d transponders:\n", Services, Transponders);
+  printf("  one thread per job, %2d at once: %10.1f us\n", Filters, before);
+  printf("  cPmtPool of %2d workers:         %10.1f us\n", hw.Size(), filters);
+  printf("  cPmtPool of %2d workers:         %10.1f us\n", sw.Size(), pids);
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * wirbelscan: A plugin for the Video Disk Recorder
+ * See the README file for copyright information and how to reach the author.
+ ******************************************************************************/
+#include <chrono>
+#include <cstdio>       // printf()
+#include "../tlist.h"   // TList<T>
+
+/*******************************************************************************
+ * a loop over all items of a TList: Count() and operator[] on each item (two
+ * lock round trips per item), versus one Lock()ed view, one Snapshot() and an
+ * unshared list, which doesn't lock at all.
+ ******************************************************************************/
+
+static const int Items  = 10000;
+static const int Rounds = 1000;
+
+static volatile long sink;
+
+template<class F> static double Measure(F Func) {
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < Rounds; i++)
+     sink += Func();
+  std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+  return ns.count() / Rounds / Items;
+}
+
+int main(void) {
+  TList<int> list, unshared;
+  for(int i = 0; i < Items; i++) {
+     list.Add(i);
+     unshared.Add(i);
+     }
+  unshared.Shared(false);
+
+  double indexed = Measure([&list]{
+     long sum = 0;
+     for(int i = 0; i < list.Count(); i++)
+        sum += list[i];
+     return sum;
+     });
+
+  double view = Measure([&list]{
+     long sum = 0;
+     for(auto i:list.Lock())
+        sum += i;
+     return sum;
+     });
+
+  double snapshot = Measure([&list]{
+     long sum = 0;
+     for(auto i:list.Snapshot())
+        sum += i;
+     return sum;
+     });
+
+  double single = Measure([&unshared]{
+     long sum = 0;
+     for(int i = 0; i < unshared.Count(); i++)
+        sum += unshared[i];
+     return sum;
+     });
+
+  printf("loop over %d items, ns per item:\n", Items);
+  printf("  Count() and operator[]: %8.2f\n", indexed);
+  printf("  Lock()                : %8.2f\n", view);
+  printf("  Snapshot()            : %8.2f\n", snapshot);
+  printf("  Shared(false)         : %8.2f\n", single);
+  return 0;
+}
@@ -4,6 +4,7 @@
  ******************************************************************************/
 #pragma once
 #include <vector>
+#include <deque>
 #include <mutex>
 #include <algorithm>
 
@@ -22,47 +23,87 @@ typedef bool (*TListSortCompare)(void* Item1, void* Item2);
 template<class T> class TList {
 private:
   std::mutex m;
+  bool shared;
+
+  class TGuard {                                         // locks the list, if it's shared.
+  private:
+     std::mutex* m;
+  public:
+     TGuard(TList<T>* l) : m(l->shared ? &l->m : nullptr) { if (m) m->lock(); }
+     ~TGuard() { if (m) m->unlock(); }
+  };
 protected:
   std::vector<T> v;
 public:
-  TList(void) {}                                         // constructor
-  TList(const TList<T>& other) : v(other.v) {}           // non-swap copy constructor
+  TList(void) : shared(true) {}                          // constructor
+  TList(const TList<T>& other) : shared(true), v(other.v) {} // non-swap copy constructor
   ~TList() { v.clear(); }
 
+  /* a locked view of the list, for loops over all items: the lock is taken
+   * once instead of on each Count() and operator[]. Don't call the list's own
+   * methods while holding a view of it.
+   *    for(auto item:list.Lock()) ...
+   */
+  class TView {
+  private:
+     std::unique_lock<std::mutex> lock;
+     std::vector<T>& v;
+  public:
+     TView(TList<T>* l) : lock(l->m, std::defer_lock), v(l->v) { if (l->shared) lock.lock(); }
+     TView(TView&& other) : lock(std::move(other.lock)), v(other.v) {}
+     int Count(void) const { return v.size(); }
+     T& operator[](int Index) { return v[Index]; }
+     typename std::vector<T>::iterator begin(void) { return v.begin(); }
+     typename std::vector<T>::iterator end(void) { return v.end(); }
+  };
+
+  TView Lock(void) {                                     // Returns a locked view, see TView.
+     return TView(this);
+     }
+
+  std::vector<T> Snapshot(void) {                        // Returns a copy of all items, taken with one lock.
+     const TGuard lock(this);
+     return v;
+     }
+
+  void Shared(bool On) {                                 // Off: list is used by one thread only, no locking.
+     shared = On;
+     }
+
   void Add(T p) {                                        // Add a new item to the list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.push_back(p);
      if (v.size() == v.capacity())
         v.reserve(v.capacity() << 1);
      }
 
   int Capacity(void) {                                   // returns max number of items
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v.capacity();
      }
 
   void Capacity(size_t newCap) {                         // sets max number of items
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.reserve(newCap);
      }
 
   void Clear(void) {                                     // Clears the list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.clear();
      }
 
   int Count(void) {                                      // Current number of items.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v.size();
      }
 
   void Delete(size_t Index) {                            // Removes items from list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.erase(v.begin()+Index);
      }
 
   void Exchange(size_t Index1, size_t Index2) {          // Exchanges two items
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      T p1 = v[Index1];
      T p2 = v[Index2];
      v[Index1] = p2;
@@ -70,24 +111,24 @@ public:
      }
 
   TList<T> Expand(void) {                                // Increases the capacity of the list if needed.                 
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      if (v.size() == v.capacity())
         v.resize(v.capacity() << 1);
      return *this;
      }
 
   T First(void) {                                       // Returns the first non-nil pointer in the list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v.front();
      }
 
   T Last(void)  {                                       // Returns the last non-nil pointer in the list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v.back();
      }
 
   int IndexOf(T Item) {                                 // Returns the index of a given item.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      for(size_t i=0; i<v.size(); i++) {
         if (v[i] == Item)
            return i;
@@ -96,7 +137,7 @@ public:
      }
 
   void Insert(size_t Index, T Item) {                   // Inserts a new pointer in the list at a given position.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.insert(v.begin() + Index , Item);
      }
 
@@ -104,7 +145,7 @@ public:
      if (CurIndex == NewIndex)
         return;
 
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      T& item = v[CurIndex];
      Delete(CurIndex);
 
@@ -115,25 +156,25 @@ public:
      }
 
   T& operator[](int const& Index) {                     // Provides access to Items (pointers) in the list.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v[Index];
      }
 
   TList<T>& operator=(const TList<T>& other) {          // copy assignment operator.
      if (this != &other) {
-        const std::lock_guard<std::mutex> lock(m);
+        const TGuard lock(this);
         v = other.v;
         }
      return *this;
      }
 
   T& Items(size_t const& Index) {
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v[Index];
      }
 
   int Remove(T Item) {                                  // Removes a value from the list & returns it's index before removal
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      for(size_t i=0; i<v.size(); i++) {
         if (v[i] == Item) {
            v.erase(v.begin()+i);
@@ -144,32 +185,80 @@ public:
      }
 
   void Sort(TListSortCompare Compare) {                 // Sorts the items in the list using a function.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      std::sort(v.begin(), v.end(), Compare);
      }
 
   void Sort(void) {                                     // Sorts the items in the list using operator '<'.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      std::sort(v.begin(), v.end());
      }
 
   void Assign(TList<T>& from) {                         // Copy the contents of other lists.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.assign(from.v.begin(), from.v.end());
      }
 
   void AddList(TList<T>& aList) {                       // Add all items from another list
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.insert(v.end(),aList.v.begin(),aList.v.end());
      }
 
   T* List(void) {                                       // Returns the items in an array.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      return v.data();
      }
 
   void Pack(void) {                                     // Removes nullptr's from the list and frees unused memory.
-     const std::lock_guard<std::mutex> lock(m);
+     const TGuard lock(this);
      v.shrink_to_fit();
      }
 };
+
+
+/*******************************************************************************
+ * class TArena
+ * owns objects of one lifetime, ie. all TChannels of a scan. New() returns a
+ * default constructed item, Free() takes it back for reuse, Clear() destroys
+ * all of them at once. Items never move, pointers stay valid until Clear().
+ ******************************************************************************/
+template<class T> class TArena {
+private:
+  std::mutex m;
+  std::deque<T> items;
+  std::vector<T*> unused;
+  size_t reused;
+public:
+  TArena(void) : reused(0) {}
+
+  T* New(void) {
+     const std::lock_guard<std::mutex> lock(m);
+     if (unused.size()) {
+        T* item = unused.back();
+        unused.pop_back();
+        ++reused;
+        return item;
+        }
+     items.emplace_back();
+     return &items.back();
+     }
+
+  void Free(T* item) {                                  // item is reset and reused by a later New().
+     if (item == nullptr)
+        return;
+     *item = T();
+     const std::lock_guard<std::mutex> lock(m);
+     unused.push_back(item);
+     }
+
+  void Clear(void) {                                    // Destroys all items, including those in use.
+     const std::lock_guard<std::mutex> lock(m);
+     unused.clear();
+     items.clear();
+     reused = 0;
+     }
+
+  size_t Count(void)  { const std::lock_guard<std::mutex> lock(m); return items.size(); }                 // allocated
+  size_t InUse(void)  { const std::lock_guard<std::mutex> lock(m); return items.size() - unused.size(); }
+  size_t Reused(void) { const std::lock_guard<std::mutex> lock(m); return reused; }                       // New() calls without allocation
+};
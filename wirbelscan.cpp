@@ -14,6 +14,8 @@
 #include "menusetup.h"
 #include "countries.h"
 #include "satellites.h"
+#include "lockprofiles.h"
+#include "sicache.h"
 
 class cScanner;
 
@@ -65,6 +67,8 @@ bool cPluginWirbelscan::Initialize(void) {
 
 // Start any background activities the plugin shall perform.
 bool cPluginWirbelscan::Start(void) {
+  LockProfiles.Load(std::string(ConfigDirectory(Name())) + "/lockprofiles.conf");
+  SiCache.Load(std::string(ConfigDirectory(Name())) + "/sicache.conf");
   return true;
 }
 
@@ -121,6 +125,9 @@ bool cPluginWirbelscan::SetupParse(const char* Name, const char* Value) {
   else if (name == "ParseLCN")         wSetup.ParseLCN             = std::stol(Value) != 0;
   else if (name == "SignalWaitTime")   wSetup.SignalWaitTime       = constrain(std::stoi(Value), 1, 5);
   else if (name == "LockTimeout")      wSetup.LockTimeout          = constrain(std::stoi(Value), 1, 10);
+  else if (name == "ParallelScan")     wSetup.ParallelScan         = constrain(std::stoi(Value), 0, 1);
+  else if (name == "SdtOther")         wSetup.SdtOther             = constrain(std::stoi(Value), 0, 1);
+  else if (name == "PreSweep")         wSetup.PreSweep             = constrain(std::stoi(Value), 0, 1);
   else if (name == "preferred") {
      auto items = SplitStr(Value,';');
      for(size_t i=0; i<std::min(items.size(),wSetup.preferred.size()); i++)
@@ -160,6 +167,9 @@ void cPluginWirbelscan::StoreSetup(void) {
   SetupStore("an",              wSetup.scan_append_new);
   SetupStore("SignalWaitTime",  wSetup.SignalWaitTime);
   SetupStore("LockTimeout",     wSetup.LockTimeout);
+  SetupStore("ParallelScan",    wSetup.ParallelScan);
+  SetupStore("SdtOther",        wSetup.SdtOther);
+  SetupStore("PreSweep",        wSetup.PreSweep);
   SetupStore("preferred",       preferred.c_str());
   Setup.Save();
 }
@@ -215,10 +225,13 @@ bool cPluginWirbelscan::Service(const char* id, void* Data) {
            s->status = StatusScanning;
         else
            s->status = StatusStopped;
+        {
+        const std::lock_guard<std::mutex> lock(lMutex);
         memset(s->curr_device, 0, 256);
         strcpy(s->curr_device, lDeviceName.size()? lDeviceName.c_str():"none");
         memset(s->transponder, 0, 256);
         strcpy(s->transponder, lTransponder.length()? lTransponder.c_str():"none");
+        }
         s->progress = s->status == StatusScanning?lProgress:0;
         s->strength = s->status == StatusScanning?lStrength:0;
         s->numChannels = 0;              // Channels.Count(); // not possible any longer.
@@ -344,10 +357,8 @@ bool cPluginWirbelscan::Service(const char* id, void* Data) {
         if (! Data) return true; // check for support
         extern TChannels NewChannels;
         std::vector<TChannel>* list = (std::vector<TChannel>*) Data;
-        for(int idx = 0; idx < NewChannels.Count(); ++idx) {
-           TChannel t = *NewChannels[idx];
-           list->push_back(t);
-           }
+        for(auto ch:NewChannels.Lock())
+           list->push_back(*ch);
         return true;
         }
      default: